@@ -0,0 +1,142 @@
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <dirent.h>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+#include "render/coordinator.hpp"
+
+using gasket::Complex;
+using gasket::Flame;
+using gasket::Mobius;
+using std::string;
+using std::vector;
+
+// Runs the coordinator with local workers on one box: killing a worker
+// mid-render must requeue its frames, and a frame that cannot be rendered
+// must use up its own attempts without taking the worker down.
+
+namespace {
+
+Flame makeFlame(double logscale) {
+    Flame flame;
+    flame.logscale = logscale;
+    flame.width = 64;
+    flame.height = 36;
+    for (int k=0; k<3; k++) {
+        double angle = 2*M_PI*k/3;
+        flame.transforms.push_back(Mobius<double>(Complex<double>(0.5),
+            Complex<double>(0.5*cos(angle), 0.5*sin(angle)),
+            Complex<double>(0), Complex<double>(1)));
+        flame.colorParams.colorValues.push_back(k/2.0);
+    }
+    return flame;
+}
+
+// Pids whose parent is this process.
+vector<pid_t> children() {
+    vector<pid_t> pids;
+    DIR* dir = opendir("/proc");
+    if (!dir) {
+        return pids;
+    }
+    while (dirent* entry = readdir(dir)) {
+        pid_t pid = atoi(entry->d_name);
+        if (pid <= 0) {
+            continue;
+        }
+        std::ifstream stat("/proc/" + string(entry->d_name) + "/stat");
+        string line;
+        std::getline(stat, line);
+        // The parent pid follows the state, after the parenthesized command
+        // name, which may itself contain spaces.
+        pid_t parent = 0;
+        size_t close = line.rfind(')');
+        if (close != string::npos && sscanf(line.c_str() + close + 1, " %*c %d", &parent) == 1 &&
+            parent == getpid()) {
+
+            pids.push_back(pid);
+        }
+    }
+    closedir(dir);
+    return pids;
+}
+
+string socketPath(const char* name) {
+    return "/tmp/gasket-" + string(name) + "-" + std::to_string(getpid()) + ".sock";
+}
+
+bool testKilledWorker() {
+    render::RenderJob job;
+    job.numSamples = 1 << 16;
+    job.numThreads = 1;
+    vector<Flame> flames;
+    for (int i=0; i<24; i++) {
+        flames.push_back(makeFlame(i));
+    }
+    render::Coordinator coordinator(socketPath("kill"), job, 2, 4);
+    vector<int> received(flames.size(), 0);
+    bool killed = false;
+    coordinator.run(flames, [&](int index, const boost::gil::rgb8_image_t& image) {
+        received[index]++;
+        if (!killed) {
+            auto pids = children();
+            if (!pids.empty()) {
+                kill(pids[0], SIGKILL);
+                killed = true;
+            }
+        }
+    });
+    if (!killed) {
+        fprintf(stderr, "kill: no worker found to kill\n");
+        return false;
+    }
+    for (int i=0; i<received.size(); i++) {
+        if (received[i] != 1) {
+            fprintf(stderr, "kill: frame %d delivered %d times\n", i, received[i]);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool testFailingFrame() {
+    render::RenderJob job;
+    job.numSamples = 1 << 12;
+    job.numThreads = 1;
+    vector<Flame> flames;
+    for (int i=0; i<8; i++) {
+        flames.push_back(makeFlame(i));
+    }
+    flames[5].colorParams.colorValues.pop_back();
+    render::Coordinator coordinator(socketPath("fail"), job, 2, 4);
+    pid_t self = getpid();
+    try {
+        coordinator.run(flames, [](int, const boost::gil::rgb8_image_t&) { });
+    } catch (const std::runtime_error& e) {
+        if (getpid() != self) {
+            _exit(2);
+        }
+        if (string(e.what()).find("Frame 5 failed") != 0) {
+            fprintf(stderr, "fail: unexpected error: %s\n", e.what());
+            return false;
+        }
+        return true;
+    }
+    fprintf(stderr, "fail: bad frame was not reported\n");
+    return false;
+}
+
+}
+
+int main() {
+    bool ok = true;
+    ok &= testKilledWorker();
+    ok &= testFailingFrame();
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
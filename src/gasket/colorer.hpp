@@ -4,6 +4,9 @@
 #include "key_gasket.hpp"
 #include <algorithm>
 #include <boost/gil.hpp>
+#include <map>
+#include <type_traits>
+#include <utility>
 
 namespace gasket {
 
@@ -16,4 +19,13 @@ public:
     virtual ~Colorer() { }
 };
 
+template <typename ColorerT, typename = void>
+struct IsColorer : std::false_type { };
+
+template <typename ColorerT>
+struct IsColorer<ColorerT, std::void_t<
+    decltype(std::declval<ColorerT&>().keyGaskets(
+        std::declval<const std::map<double, KeyGasket>&>())),
+    decltype(ColorParams(std::declval<const ColorerT&>().color(0.0, 0)))>> : std::true_type { };
+
 }
\ No newline at end of file
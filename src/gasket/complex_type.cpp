@@ -41,11 +41,43 @@ double toDouble<mpq_class>(mpq_class x) {
     return f.get_d();
 }
 
+template <>
+double toDouble<double>(double x) {
+    return x;
+}
+
+template <>
+double toDouble<long double>(long double x) {
+    return x;
+}
+
+template <>
+mpq_class fromRatio<mpq_class>(int num, int den) {
+    mpq_class ans(num, den);
+    ans.canonicalize();
+    return ans;
+}
+
+template <>
+double fromRatio<double>(int num, int den) {
+    return num / (double)den;
+}
+
+template <>
+long double fromRatio<long double>(int num, int den) {
+    return num / (long double)den;
+}
+
 template <>
 cx Complex<double>::toCxDouble() const {
     return cx(real, imag);
 }
 
+template <>
+cx Complex<long double>::toCxDouble() const {
+    return cx(real, imag);
+}
+
 template <>
 mpz_class squareRoot<mpz_class>(mpz_class s) {
     if (s < 0) {
@@ -74,6 +106,22 @@ mpq_class squareRoot<mpq_class>(mpq_class x) {
     return mpq_class(n.get_str()+"/"+d.get_str());
 }
 
+template <>
+double squareRoot<double>(double x) {
+    if (x < 0) {
+        throw std::invalid_argument("Square root of negative number.");
+    }
+    return sqrt(x);
+}
+
+template <>
+long double squareRoot<long double>(long double x) {
+    if (x < 0) {
+        throw std::invalid_argument("Square root of negative number.");
+    }
+    return sqrtl(x);
+}
+
 template<>
 Complex<mpq_class> squareRoot<Complex<mpq_class>>(Complex<mpq_class> z) {
     auto x = z.real;
@@ -93,6 +141,12 @@ Complex<double> squareRoot<Complex<double>>(Complex<double> z) {
     return Complex<double>(u.real(), u.imag());
 }
 
+template<>
+Complex<long double> squareRoot<Complex<long double>>(Complex<long double> z) {
+    std::complex<long double> u = sqrt(std::complex<long double>(z.real,z.imag));
+    return Complex<long double>(u.real(), u.imag());
+}
+
 template <>
 Complex<double> Complex<double>::toComplexDouble() const {
     return *this;
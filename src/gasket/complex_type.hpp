@@ -82,6 +82,9 @@ double toDouble(T x);
 template <typename T>
 T abs(T x);
 
+template <typename T>
+T fromRatio(int num, int den);
+
 template <typename T>
 T abs(T x) {
     return x > 0 ? x : -x;
@@ -2,6 +2,8 @@
 
 #include "mobius.hpp"
 #include <random>
+#include <type_traits>
+#include <utility>
 
 namespace gasket {
 
@@ -9,9 +11,17 @@ template<typename T>
 class Diver {
 public:
     Diver() { }
-    virtual int chooseDive(Mobius<T> accumulator) const = 0;
+    virtual int chooseDive(const Mobius<T>& accumulator) const = 0;
     virtual int getDepth() const = 0;
     virtual ~Diver() { }
 };
 
+template <typename DiverT, typename T, typename = void>
+struct IsDiver : std::false_type { };
+
+template <typename DiverT, typename T>
+struct IsDiver<DiverT, T, std::void_t<
+    decltype(int(std::declval<const DiverT&>().chooseDive(std::declval<const Mobius<T>&>()))),
+    decltype(int(std::declval<const DiverT&>().getDepth()))>> : std::true_type { };
+
 }
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <future>
+#include <memory>
+#include <stdexcept>
+#include "exporter.hpp"
+#include "flame_sequence.hpp"
+#include "scheduling.hpp"
+
+namespace gasket {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+void appendDouble(string& out, double x) {
+    char buf[32];
+    auto res = std::to_chars(buf, buf + sizeof(buf), x);
+    out.append(buf, res.ptr);
+}
+
+void appendInt(string& out, long long x) {
+    char buf[24];
+    auto res = std::to_chars(buf, buf + sizeof(buf), x);
+    out.append(buf, res.ptr);
+}
+
+void appendAttribute(string& out, const char* name, double x) {
+    out += ' ';
+    out += name;
+    out += "=\"";
+    appendDouble(out, x);
+    out += '"';
+}
+
+void appendFlameBinary(string& out, const Flame& flame) {
+    if (flame.colorParams.colorValues.size() != flame.transforms.size()) {
+        throw std::invalid_argument("Flame needs one color value per transform.");
+    }
+    FlameSequence::Record record = {};
+    record.logscale = flame.logscale;
+    record.width = flame.width;
+    record.height = flame.height;
+    record.numTransforms = flame.transforms.size();
+    out.append((const char*)&record, sizeof(record));
+    for (auto& m: flame.transforms) {
+        double coefs[8] = {m.a.real, m.a.imag, m.b.real, m.b.imag,
+            m.c.real, m.c.imag, m.d.real, m.d.imag};
+        out.append((const char*)coefs, sizeof(coefs));
+    }
+    for (double v: flame.colorParams.colorValues) {
+        out.append((const char*)&v, sizeof(v));
+    }
+}
+
+}
+
+void appendFlameXml(string& out, const Flame& flame) {
+    out += "<flame size=\"";
+    appendInt(out, flame.width);
+    out += ' ';
+    appendInt(out, flame.height);
+    out += "\" center=\"0 0\"";
+    appendAttribute(out, "scale", flame.height / 2.0);
+    appendAttribute(out, "logscale", flame.logscale);
+    out += ">\n";
+    for (int i=0; i<flame.transforms.size(); i++) {
+        auto& m = flame.transforms[i];
+        out += "   <xform weight=\"1\"";
+        if (i < flame.colorParams.colorValues.size()) {
+            appendAttribute(out, "color", flame.colorParams.colorValues[i]);
+        }
+        out += " mobius=\"1\"";
+        appendAttribute(out, "mobius_re_a", m.a.real);
+        appendAttribute(out, "mobius_im_a", m.a.imag);
+        appendAttribute(out, "mobius_re_b", m.b.real);
+        appendAttribute(out, "mobius_im_b", m.b.imag);
+        appendAttribute(out, "mobius_re_c", m.c.real);
+        appendAttribute(out, "mobius_im_c", m.c.imag);
+        appendAttribute(out, "mobius_re_d", m.d.real);
+        appendAttribute(out, "mobius_im_d", m.d.imag);
+        out += " coefs=\"1 0 0 1 0 0\"/>\n";
+    }
+    out += "</flame>\n";
+}
+
+FlameExporter::FlameExporter(FrameSource source_, int numFrames_, int numThreads_,
+    int batchSize_): source(source_), numFrames(numFrames_), numThreads(numThreads_),
+    batchSize(batchSize_) {
+
+    if (numFrames < 0 || numThreads < 0 || batchSize <= 0) {
+        throw std::invalid_argument("Invalid exporter parameters.");
+    }
+    if (numThreads == 0) {
+        numThreads = availableCores();
+    }
+}
+
+void FlameExporter::writeXml(std::ostream& out) const {
+    out << "<flames>\n";
+    produce(appendFlameXml, [&](int, const string& data) {
+        out.write(data.data(), data.size());
+    });
+    out << "</flames>\n";
+    if (!out) {
+        throw std::runtime_error("Failed writing flames.");
+    }
+}
+
+void FlameExporter::writeXmlFiles(const string& prefix, int digits) const {
+    produce(appendFlameXml, [&](int i, const string& data) {
+        string index = std::to_string(i);
+        if (index.size() < digits) {
+            index.insert(0, digits - index.size(), '0');
+        }
+        string path = prefix + index + ".flame";
+        std::ofstream out(path, std::ios::binary);
+        out.write(data.data(), data.size());
+        if (!out) {
+            throw std::runtime_error("Failed writing " + path + ".");
+        }
+    });
+}
+
+void FlameExporter::writeBinary(const string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    FlameSequence::Header header = {};
+    memcpy(header.magic, FlameSequence::MAGIC, sizeof(header.magic));
+    header.version = FlameSequence::VERSION;
+    header.numFrames = numFrames;
+    vector<uint64_t> offsets(numFrames+1);
+    offsets[0] = sizeof(header) + offsets.size()*sizeof(uint64_t);
+    out.write((const char*)&header, sizeof(header));
+    out.write((const char*)offsets.data(), offsets.size()*sizeof(uint64_t));
+    produce(appendFlameBinary, [&](int i, const string& data) {
+        out.write(data.data(), data.size());
+        offsets[i+1] = offsets[i] + data.size();
+    });
+    out.seekp(sizeof(header));
+    out.write((const char*)offsets.data(), offsets.size()*sizeof(uint64_t));
+    if (!out) {
+        throw std::runtime_error("Failed writing " + path + ".");
+    }
+}
+
+void FlameExporter::produce(Serialize serialize, Consume consume) const {
+    typedef vector<string> Batch;
+    int numBatches = (numFrames + batchSize - 1) / batchSize;
+    int window = 2*numThreads;
+    vector<std::future<Batch>> batches(numBatches);
+    boost::asio::thread_pool threadPool(numThreads);
+    auto launch = [&](int b) {
+        auto task = std::make_shared<std::packaged_task<Batch()>>([&, b] {
+            Batch ans;
+            for (int i=b*batchSize; i<std::min(numFrames, (b+1)*batchSize); i++) {
+                ans.emplace_back();
+                serialize(ans.back(), source(i));
+            }
+            return ans;
+        });
+        batches[b] = task->get_future();
+        boost::asio::post(threadPool, [task] {
+            (*task)();
+        });
+    };
+    for (int b=0; b<std::min(window, numBatches); b++) {
+        launch(b);
+    }
+    for (int b=0; b<numBatches; b++) {
+        Batch batch = batches[b].get();
+        if (b + window < numBatches) {
+            launch(b + window);
+        }
+        for (int k=0; k<batch.size(); k++) {
+            consume(b*batchSize + k, batch[k]);
+        }
+    }
+    threadPool.join();
+}
+
+}
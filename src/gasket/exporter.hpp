@@ -0,0 +1,34 @@
+#pragma once
+
+#include "flame.hpp"
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace gasket {
+
+void appendFlameXml(std::string& out, const Flame& flame);
+
+class FlameExporter {
+public:
+    // Called concurrently from the export threads.
+    typedef std::function<Flame(int)> FrameSource;
+
+    // Zero threads uses availableCores().
+    FlameExporter(FrameSource source, int numFrames, int numThreads = 0,
+        int batchSize = 16);
+    void writeXml(std::ostream& out) const;
+    void writeXmlFiles(const std::string& prefix, int digits = 3) const;
+    void writeBinary(const std::string& path) const;
+private:
+    typedef std::function<void(std::string&, const Flame&)> Serialize;
+    typedef std::function<void(int, const std::string&)> Consume;
+
+    void produce(Serialize serialize, Consume consume) const;
+
+    FrameSource source;
+    int numFrames, numThreads, batchSize;
+};
+
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+#include "color_params.hpp"
+#include "mobius.hpp"
+#include <vector>
+
+namespace gasket {
+
+struct Flame {
+    double logscale;
+    int width, height;
+    std::vector<Mobius<double>> transforms;
+    ColorParams colorParams;
+};
+
+}
@@ -0,0 +1,97 @@
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "flame_sequence.hpp"
+
+namespace gasket {
+
+using std::string;
+
+const char FlameSequence::MAGIC[8] = "GASKFLM";
+
+FlameSequence::FlameSequence(const string& path) {
+    fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open flame sequence " + path + ".");
+    }
+    struct stat st;
+    if (fstat(fd, &st) < 0 || st.st_size < sizeof(Header)) {
+        close(fd);
+        throw std::runtime_error(path + " is not a flame sequence.");
+    }
+    length = st.st_size;
+    void* mapped = mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Could not map flame sequence " + path + ".");
+    }
+    base = (const char*)mapped;
+    header = (const Header*)base;
+    offsets = (const uint64_t*)(base + sizeof(Header));
+    uint64_t numFrames = header->numFrames;
+    bool valid = memcmp(header->magic, MAGIC, sizeof(MAGIC)) == 0 &&
+        header->version == VERSION &&
+        numFrames < (length - sizeof(Header)) / sizeof(uint64_t);
+    // Every offset is bounds-checked before any record is read: records must
+    // follow the offset table in order, be aligned, and hold at least a
+    // Record each, with the last one ending inside the file.
+    uint64_t tableEnd = sizeof(Header) + (numFrames+1)*sizeof(uint64_t);
+    valid = valid && offsets[0] >= tableEnd && offsets[numFrames] <= length;
+    for (uint64_t i=0; valid && i<numFrames; i++) {
+        valid = offsets[i] % alignof(Record) == 0 && offsets[i] <= offsets[i+1] &&
+            offsets[i+1] - offsets[i] >= sizeof(Record);
+    }
+    for (uint64_t i=0; valid && i<numFrames; i++) {
+        uint64_t values = offsets[i+1] - offsets[i] - sizeof(Record);
+        valid = values % (9*sizeof(double)) == 0 &&
+            values / (9*sizeof(double)) == record(i)->numTransforms;
+    }
+    if (!valid) {
+        munmap(mapped, length);
+        close(fd);
+        throw std::runtime_error(path + " is not a valid flame sequence.");
+    }
+}
+
+FlameSequence::~FlameSequence() {
+    munmap((void*)base, length);
+    close(fd);
+}
+
+int FlameSequence::size() const {
+    return header->numFrames;
+}
+
+Flame FlameSequence::at(int i) const {
+    if (i < 0 || i >= size()) {
+        throw std::out_of_range("Frame index out of range.");
+    }
+    const Record* r = record(i);
+    const double* values = (const double*)(r + 1);
+    Flame flame;
+    flame.logscale = r->logscale;
+    flame.width = r->width;
+    flame.height = r->height;
+    for (uint32_t k=0; k<r->numTransforms; k++) {
+        const double* m = values + 8*k;
+        flame.transforms.push_back(Mobius<double>(Complex<double>(m[0], m[1]),
+            Complex<double>(m[2], m[3]), Complex<double>(m[4], m[5]),
+            Complex<double>(m[6], m[7])));
+    }
+    const double* colors = values + 8*r->numTransforms;
+    flame.colorParams.colorValues.assign(colors, colors + r->numTransforms);
+    return flame;
+}
+
+size_t FlameSequence::recordSize(int numTransforms) {
+    return sizeof(Record) + numTransforms*9*sizeof(double);
+}
+
+const FlameSequence::Record* FlameSequence::record(int i) const {
+    return (const Record*)(base + offsets[i]);
+}
+
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "flame.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace gasket {
+
+class FlameSequence {
+public:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t numFrames;
+    };
+    struct Record {
+        double logscale;
+        int32_t width, height;
+        uint32_t numTransforms;
+        uint32_t reserved;
+    };
+    static const char MAGIC[8];
+    static const uint32_t VERSION = 1;
+
+    FlameSequence(const std::string& path);
+    FlameSequence(const FlameSequence&) = delete;
+    FlameSequence& operator=(const FlameSequence&) = delete;
+    ~FlameSequence();
+    int size() const;
+    Flame at(int i) const;
+    static size_t recordSize(int numTransforms);
+private:
+    const Record* record(int i) const;
+
+    int fd;
+    size_t length;
+    const char* base;
+    const Header* header;
+    const uint64_t* offsets;
+};
+
+}
@@ -17,4 +17,17 @@ int KeyGasket::numTransforms() const {
     return ifsTransforms.size();
 }
 
+const vector<Mobius<double>>& KeyGasket::getTransforms() const {
+    return ifsTransforms;
+}
+
+vector<Mobius<double>> KeyGasket::scaledTransforms(double scale) const {
+    auto s = Mobius<double>::scaling(Complex<double>(scale));
+    vector<Mobius<double>> ans;
+    for (auto& m: ifsTransforms) {
+        ans.push_back(m.conjugate(s));
+    }
+    return ans;
+}
+
 }
\ No newline at end of file
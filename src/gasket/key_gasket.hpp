@@ -12,6 +12,8 @@ public:
     KeyGasket(std::vector<Mobius<double>> ifsTransforms, int level);
     int level = 0;
     int numTransforms() const;
+    const std::vector<Mobius<double>>& getTransforms() const;
+    std::vector<Mobius<double>> scaledTransforms(double scale) const;
 private:
     std::vector<Mobius<double>> ifsTransforms;
 };
@@ -24,7 +24,7 @@ public:
 
     Complex<T> a, b, c, d;
 
-    Complex<T> apply(Complex<T> z) const {
+    Complex<T> apply(const Complex<T>& z) const {
         return (a*z+b)/(c*z+d);
     }
 
@@ -33,11 +33,11 @@ public:
         return Mobius<T>(sc*d,-sc*b,-sc*c,sc*a);
     }
 
-    Mobius<T> compose(Mobius<T> n) const {
+    Mobius<T> compose(const Mobius<T>& n) const {
         return Mobius<T>(a*n.a + b*n.c, a*n.b + b*n.d, c*n.a + d*n.c, c*n.b + d*n.d);
     }
 
-    Mobius<T> conjugate(Mobius<T> s) const {
+    Mobius<T> conjugate(const Mobius<T>& s) const {
         return s.compose(*this).compose(s.inverse());
     }
 
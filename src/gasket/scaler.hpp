@@ -9,17 +9,19 @@ template <typename T>
 class Scaler {
 public:
     Scaler(T iniLogscale_, T step_, int numSteps_, int precDigits):
-        iniLogscale(iniLogscale_), step(step_), numSteps(numSteps_) {
+        iniLogscale(iniLogscale_), step(step_), numSteps(numSteps_), prec(1) {
 
-        mpq_class prec(1);
         for (int i=0; i<precDigits; i++) {
             prec = prec / 10;
         }
         base = expPrec<T>(iniLogscale, prec);
-        lookup.resize(32-__builtin_clz(numSteps));
-        for (int i=0; i<lookup.size(); i++) {
-            lookup[i] = expPrec<T>((1<<i)*step, prec);
-        }
+        growLookup();
+    }
+    Scaler(const Scaler& other, int numSteps_): iniLogscale(other.iniLogscale),
+        step(other.step), numSteps(numSteps_), prec(other.prec), base(other.base),
+        lookup(other.lookup) {
+
+        growLookup();
     }
     T lookupExp(int n) const {
         T ans = base;
@@ -33,6 +35,14 @@ public:
     const T iniLogscale, step;
     const int numSteps;
 private:
+    void growLookup() {
+        int size = 32-__builtin_clz(numSteps);
+        for (int i=lookup.size(); i<size; i++) {
+            lookup.push_back(expPrec<T>((1<<i)*step, prec));
+        }
+    }
+
+    T prec;
     T base;
     std::vector<T> lookup;
 };
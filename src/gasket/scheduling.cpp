@@ -0,0 +1,94 @@
+#include "scheduling.hpp"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+
+namespace gasket {
+
+namespace {
+
+std::vector<int> allowedCpus() {
+    std::vector<int> cpus;
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int i=0; i<CPU_SETSIZE; i++) {
+            if (CPU_ISSET(i, &set)) {
+                cpus.push_back(i);
+            }
+        }
+    }
+    return cpus;
+}
+
+// CPUs granted by the cgroup quota, or 0 when there is none. cgroup v2 keeps
+// "<quota> <period>" in cpu.max; v1 splits them across two files.
+int cgroupQuota() {
+    double quota = -1, period = 0;
+    std::ifstream v2("/sys/fs/cgroup/cpu.max");
+    std::string quotaText;
+    if (v2 >> quotaText >> period) {
+        if (quotaText != "max") {
+            quota = std::stod(quotaText);
+        }
+    } else {
+        std::ifstream quotaFile("/sys/fs/cgroup/cpu/cpu.cfs_quota_us");
+        std::ifstream periodFile("/sys/fs/cgroup/cpu/cpu.cfs_period_us");
+        if (!(quotaFile >> quota) || !(periodFile >> period)) {
+            quota = -1;
+        }
+    }
+    if (quota <= 0 || period <= 0) {
+        return 0;
+    }
+    return std::max(1, (int)std::ceil(quota / period));
+}
+
+}
+
+int availableCores() {
+    int cores = std::thread::hardware_concurrency();
+    int affinity = allowedCpus().size();
+    if (affinity > 0) {
+        cores = cores > 0 ? std::min(cores, affinity) : affinity;
+    }
+    int quota = cgroupQuota();
+    if (quota > 0) {
+        cores = cores > 0 ? std::min(cores, quota) : quota;
+    }
+    return std::max(1, cores);
+}
+
+WorkerPool::WorkerPool(int numThreads_, bool pinThreads):
+    numThreads(numThreads_ > 0 ? numThreads_ : availableCores()), threadPool(0) {
+
+    std::vector<int> cpus;
+    if (pinThreads) {
+        cpus = allowedCpus();
+    }
+    for (int i=0; i<numThreads; i++) {
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        threads.emplace_back([this, cpu] {
+            if (cpu >= 0) {
+                cpu_set_t set;
+                CPU_ZERO(&set);
+                CPU_SET(cpu, &set);
+                pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+            }
+            threadPool.attach();
+        });
+    }
+}
+
+WorkerPool::~WorkerPool() {
+    threadPool.stop();
+    for (auto& t: threads) {
+        t.join();
+    }
+}
+
+}
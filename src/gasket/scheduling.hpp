@@ -0,0 +1,48 @@
+#pragma once
+
+#include <boost/asio/thread_pool.hpp>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace gasket {
+
+// Number of CPUs this process can actually run on: the smallest of the
+// hardware concurrency, the scheduler affinity mask and the cgroup CPU quota.
+int availableCores();
+
+// Thread pool whose workers are our own threads attached to a
+// boost::asio::thread_pool, so they can be pinned to cores before taking
+// work. Callers must wait for their own tasks; destroying the pool stops it.
+class WorkerPool {
+public:
+    explicit WorkerPool(int numThreads = 0, bool pinThreads = false);
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+    ~WorkerPool();
+    boost::asio::thread_pool& get() {
+        return threadPool;
+    }
+    int size() const {
+        return numThreads;
+    }
+private:
+    int numThreads;
+    boost::asio::thread_pool threadPool;
+    std::vector<std::thread> threads;
+};
+
+struct Scheduling {
+    // Zero sizes the pool from availableCores().
+    int numThreads = 0;
+    bool pinThreads = false;
+    // When set, search runs on this pool and the other fields are ignored;
+    // the same pool can be handed to render::Renderer.
+    std::shared_ptr<WorkerPool> pool;
+
+    std::shared_ptr<WorkerPool> makePool() const {
+        return pool ? pool : std::make_shared<WorkerPool>(numThreads, pinThreads);
+    }
+};
+
+}
@@ -7,8 +7,10 @@
 #include <array>
 #include <boost/asio/post.hpp>
 #include <boost/asio/thread_pool.hpp>
+#include <condition_variable>
 #include <map>
 #include <memory>
+#include <mutex>
 
 namespace gasket {
 
@@ -21,29 +23,32 @@ public:
         bool inverseDive_,
         const std::vector<Mobius<T>>& zoomTransforms_,
         std::map<double, KeyGasket>& keyGaskets_,
-        T ar_, int numThreads_ = 4):
+        T ar_, boost::asio::thread_pool& threadPool_, int numThreads_ = 4):
         shape(shape_), center(center_), inverseDive(inverseDive_),
-        ar(ar_), numThreads(numThreads_), scaler(scaler_), threadPool(numThreads_),
-        zoomTransforms(zoomTransforms_), keyGaskets(keyGaskets_), lastPickedUp(numThreads_-1) {
+        ar(ar_), numThreads(numThreads_), scaler(scaler_), threadPool(threadPool_),
+        zoomTransforms(zoomTransforms_), keyGaskets(keyGaskets_) {
 
         pts = shape.startingPoints(inverseDive);
         transforms = shape.diveArray(inverseDive);
     }
 
-    void start(){
+    void start(int firstLevel = 0){
         Sdf<T> sdf = Sdf<T>::fromPoints(pts[0], pts[1], pts[2]);
         T iniScale = scaler.lookupExp(0);
         T iniHeight = 2/iniScale;
         T iniWidth = iniHeight*ar;
-        if (!sdf.rectInside(center, iniWidth, iniHeight)) {
+        if (firstLevel == 0 && !sdf.rectInside(center, iniWidth, iniHeight)) {
             std::vector<Mobius<double>> gasketTransforms;
             auto transforms = shape.doubleSidedTransforms(scaler.lookupExp(0), center);
             gasketTransforms.insert(gasketTransforms.end(), transforms.begin(), transforms.end());
             double iniLogscaleDouble = toDouble(scaler.iniLogscale);
-            KeyGasket g(gasketTransforms, iniLogscaleDouble);
+            KeyGasket g(gasketTransforms, -1);
             keyGaskets.insert(std::pair<double, KeyGasket>(iniLogscaleDouble, g));
         }
-        for (int i=0; i<numThreads; i++) {
+        std::lock_guard<std::mutex> guard(lock);
+        for (int i=firstLevel; i<firstLevel+numThreads && i<zoomTransforms.size(); i++) {
+            lastPickedUp = i;
+            pending++;
             boost::asio::post(threadPool, [=] {
                 task(i);
             });
@@ -51,7 +56,8 @@ public:
     }
 
     void block() {
-        threadPool.join();
+        std::unique_lock<std::mutex> guard(lock);
+        finished.wait(guard, [this] { return pending == 0; });
     }
 private:
     void task(int i) {
@@ -74,21 +80,26 @@ private:
         double logscaleDouble = toDouble(logscale);
         KeyGasket g(gasketTransforms, i);
 
-        lock.lock();
+        std::lock_guard<std::mutex> guard(lock);
         auto it = keyGaskets.find(logscaleDouble);
-        if (it == keyGaskets.end() || i > it->second.level) {
-            keyGaskets.insert(std::pair<double, KeyGasket>(logscaleDouble, g));
-        }
         if (scaleVal >= scaler.numSteps) {
             foundEnd = true;
+            if (it == keyGaskets.end() || i < it->second.level) {
+                keyGaskets.insert_or_assign(logscaleDouble, g);
+            }
+        } else if (it == keyGaskets.end() || i > it->second.level) {
+            keyGaskets.insert_or_assign(logscaleDouble, g);
         }
-        if (!foundEnd) {
-            lastPickedUp++;
+        if (!foundEnd && lastPickedUp+1 < zoomTransforms.size()) {
+            int next = ++lastPickedUp;
+            pending++;
             boost::asio::post(threadPool, [=] {
-                task(lastPickedUp);
+                task(next);
             });
         }
-        lock.unlock();
+        if (--pending == 0) {
+            finished.notify_all();
+        }
     }
 
     int searchScale(Sdf<T> sdf) {
@@ -116,11 +127,13 @@ private:
     T ar;
     int numThreads;
     const Scaler<T>& scaler;
-    boost::asio::thread_pool threadPool;
+    boost::asio::thread_pool& threadPool;
     const std::vector<Mobius<T>>& zoomTransforms;
     std::map<double, KeyGasket>& keyGaskets;
     std::mutex lock;
-    int lastPickedUp;
+    std::condition_variable finished;
+    int pending = 0;
+    int lastPickedUp = -1;
     bool foundEnd = false;
 };
 
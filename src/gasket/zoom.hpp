@@ -3,10 +3,21 @@
 #include "colorer.hpp"
 #include "complex_type.hpp"
 #include "diver.hpp"
+#include "flame.hpp"
 #include "key_gasket.hpp"
 #include "scaler.hpp"
+#include "scheduling.hpp"
 #include "searcher.hpp"
 #include "shape.hpp"
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <cmath>
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
+#include <vector>
 
 namespace gasket {
 
@@ -14,12 +25,14 @@ template <typename T, typename DiverT, typename ColorerT>
 class Zoom {
 
 public:
+    class Batch;
+
     class Builder {
     public:
         Builder() {
-            static_assert(std::is_base_of<Diver<T>, DiverT>::value,
+            static_assert(IsDiver<DiverT, T>::value,
                 "DiverT must implement Diver<T> interface");
-            static_assert(std::is_base_of<Colorer, ColorerT>::value,
+            static_assert(IsColorer<ColorerT>::value,
                 "ColorerT must implement Colorer interface");
         }
         Builder& withShape(T r1_, T r2_, Complex<T> f_, bool flip_ = false) {
@@ -44,7 +57,19 @@ public:
             height = height_;
             return *this;
         }
-        Zoom build(DiverT diver, ColorerT colorer) {
+        Builder& withScheduling(const Scheduling& scheduling_) {
+            initScheduling = true;
+            scheduling = scheduling_;
+            return *this;
+        }
+        Zoom build(DiverT diver, ColorerT colorer) const {
+            validate();
+            return Zoom(makeShape(), diver, makeScaler(), colorer, width, height, scheduling);
+        }
+    private:
+        friend class Zoom::Batch;
+
+        void validate() const {
             if (!initShape) {
                 throw std::invalid_argument("Shape not initialized");
             }
@@ -54,11 +79,14 @@ public:
             if (!initImageSize) {
                 throw std::invalid_argument("Aspect ratio not initialized");
             }
-            Shape<T> shape(r1, r2, f, flip);
-            Scaler<T> scaler(iniLogscale, step, numSteps, precDigits);
-            return Zoom(shape, diver, scaler, colorer, width, height);
         }
-    private:
+        std::shared_ptr<const Shape<T>> makeShape() const {
+            return std::make_shared<const Shape<T>>(r1, r2, f, flip);
+        }
+        std::shared_ptr<const Scaler<T>> makeScaler() const {
+            return std::make_shared<const Scaler<T>>(iniLogscale, step, numSteps, precDigits);
+        }
+
         bool initShape = false;
         T r1, r2;
         Complex<T> f;
@@ -70,50 +98,266 @@ public:
 
         bool initImageSize = false;
         int width, height;
+
+        bool initScheduling = false;
+        Scheduling scheduling;
+    };
+
+    // Every zoom in a batch searches on the batch's pool, so a builder added
+    // with its own scheduling must agree with the batch's.
+    class Batch {
+    public:
+        Batch(const Scheduling& scheduling_ = Scheduling()): scheduling(scheduling_) { }
+        explicit Batch(int numThreads) {
+            scheduling.numThreads = numThreads;
+        }
+
+        Batch& add(const Builder& builder, DiverT diver, ColorerT colorer) {
+            builder.validate();
+            if (builder.initScheduling && conflicts(builder.scheduling)) {
+                throw std::invalid_argument("Builder scheduling conflicts with the batch's");
+            }
+            ShapeKey shapeKey(builder.r1, builder.r2, builder.f.real, builder.f.imag,
+                builder.flip);
+            auto shapeIt = shapes.find(shapeKey);
+            if (shapeIt == shapes.end()) {
+                shapeIt = shapes.emplace(shapeKey, builder.makeShape()).first;
+            }
+            ScalerKey scalerKey(builder.iniLogscale, builder.step, builder.numSteps,
+                builder.precDigits);
+            auto scalerIt = scalers.find(scalerKey);
+            if (scalerIt == scalers.end()) {
+                scalerIt = scalers.emplace(scalerKey, builder.makeScaler()).first;
+            }
+            configs.push_back({shapeIt->second, diver, scalerIt->second, colorer,
+                builder.width, builder.height});
+            return *this;
+        }
+
+        // Zooms are returned behind pointers since each colorer keeps the
+        // address of its zoom's key gasket map.
+        std::vector<std::unique_ptr<Zoom>> build() {
+            auto pool = scheduling.makePool();
+            std::vector<std::unique_ptr<Zoom>> zooms(configs.size());
+            std::vector<std::unique_ptr<Searcher<T>>> searchers(configs.size());
+            std::mutex lock;
+            std::condition_variable allStarted;
+            int started = 0;
+            for (int i=0; i<configs.size(); i++) {
+                boost::asio::post(pool->get(), [&, i] {
+                    auto& c = configs[i];
+                    zooms[i].reset(new Zoom(c.shape, c.diver, c.scaler, c.colorer,
+                        c.width, c.height));
+                    zooms[i]->scheduling = scheduling;
+                    searchers[i] = zooms[i]->startSearch(*pool);
+                    std::lock_guard<std::mutex> guard(lock);
+                    if (++started == configs.size()) {
+                        allStarted.notify_all();
+                    }
+                });
+            }
+            {
+                std::unique_lock<std::mutex> guard(lock);
+                allStarted.wait(guard, [&] { return started == configs.size(); });
+            }
+            for (int i=0; i<zooms.size(); i++) {
+                zooms[i]->finishSearch(*searchers[i]);
+            }
+            configs.clear();
+            return zooms;
+        }
+        int numShapes() const {
+            return shapes.size();
+        }
+        int numScalers() const {
+            return scalers.size();
+        }
+    private:
+        typedef std::tuple<T, T, T, T, bool> ShapeKey;
+        typedef std::tuple<T, T, int, int> ScalerKey;
+
+        struct Config {
+            std::shared_ptr<const Shape<T>> shape;
+            DiverT diver;
+            std::shared_ptr<const Scaler<T>> scaler;
+            ColorerT colorer;
+            int width, height;
+        };
+
+        // Pools are compared by identity; without one, by the settings a
+        // pool would be made from.
+        bool conflicts(const Scheduling& other) const {
+            if (other.pool || scheduling.pool) {
+                return other.pool != scheduling.pool;
+            }
+            return other.numThreads != scheduling.numThreads ||
+                other.pinThreads != scheduling.pinThreads;
+        }
+
+        Scheduling scheduling;
+        std::map<ShapeKey, std::shared_ptr<const Shape<T>>> shapes;
+        std::map<ScalerKey, std::shared_ptr<const Scaler<T>>> scalers;
+        std::vector<Config> configs;
     };
 
+    Flame getFlame(double logscale) const {
+        auto it = keyGaskets.upper_bound(logscale);
+        if (it == keyGaskets.begin()) {
+            throw std::invalid_argument("Logscale precedes the first key gasket.");
+        }
+        it = std::prev(it);
+        Flame flame;
+        flame.logscale = logscale;
+        flame.width = width;
+        flame.height = height;
+        flame.transforms = it->second.scaledTransforms(exp(logscale - it->first));
+        flame.colorParams = colorer.ColorerT::color(logscale,
+            diveIndicesMap.find(it->first)->second);
+        return flame;
+    }
+    std::vector<Flame> getFlames(double logscale, double interval, int numSubframes) const {
+        std::vector<Flame> flames;
+        for (int i=0; i<numSubframes; i++) {
+            flames.push_back(getFlame(logscale + (i+0.5)*interval/numSubframes));
+        }
+        return flames;
+    }
+    // Dives extraLevels further and widens the scale range by extraSteps
+    // steps, searching only the levels the extension can affect.
+    void extend(int extraLevels, int extraSteps = 0) {
+        if (extraLevels < 0 || extraSteps < 0) {
+            throw std::invalid_argument("Zoom can only be extended.");
+        }
+        int oldNumSteps = scaler->numSteps;
+        if (extraSteps > 0) {
+            scaler = std::make_shared<const Scaler<T>>(*scaler, oldNumSteps + extraSteps);
+        }
+
+        int firstLevel = zoomTransforms.size();
+        auto arr = shape->diveArray(inverseDive);
+        Mobius<T> acc = zoomTransforms.back();
+        for (int i=0; i<extraLevels; i++) {
+            int k = diver.DiverT::chooseDive(acc);
+            diveIndices.push_back(k);
+            acc = acc.compose(arr[k]);
+            zoomTransforms.push_back(acc);
+        }
+        auto pts = shape->startingPoints(inverseDive);
+        Complex<T> oldCenter = center;
+        center = (acc.apply(pts[0])+acc.apply(pts[1])+acc.apply(pts[2]))/Complex<T>(3);
+
+        // Moving the center by delta moves a key drawn at scale e^L by
+        // e^L*delta on screen. Keys clamped at the old end and keys whose
+        // shift is no longer negligible are searched again; the rest are
+        // translated back under the new center.
+        double iniLogscale = toDouble(scaler->iniLogscale);
+        double step = toDouble(scaler->step);
+        std::map<double, Complex<double>> shifts;
+        for (auto& g: keyGaskets) {
+            int scaleVal = std::lround((g.first - iniLogscale)/step);
+            int level = std::max(g.second.level, 0);
+            Complex<double> shift = (Complex<T>(scaler->lookupExp(scaleVal))
+                * (center - oldCenter)).toComplexDouble();
+            if (scaleVal >= oldNumSteps || shift.norm() > MAX_CENTER_SHIFT*MAX_CENTER_SHIFT) {
+                firstLevel = std::min(firstLevel, level);
+            }
+            shifts[g.first] = shift;
+        }
+        for (auto it = keyGaskets.begin(); it != keyGaskets.end(); ) {
+            if (firstLevel == 0 || it->second.level >= firstLevel) {
+                it = keyGaskets.erase(it);
+                continue;
+            }
+            auto s = Mobius<double>::translation(-shifts[it->first]);
+            std::vector<Mobius<double>> transforms;
+            for (auto& t: it->second.getTransforms()) {
+                transforms.push_back(t.conjugate(s));
+            }
+            it->second = KeyGasket(transforms, it->second.level);
+            ++it;
+        }
+
+        auto pool = scheduling.makePool();
+        auto searcher = startSearch(*pool, firstLevel);
+        finishSearch(*searcher);
+    }
+    const std::map<double, KeyGasket>& getKeyGaskets() const {
+        return keyGaskets;
+    }
+    int getWidth() const {
+        return width;
+    }
+    int getHeight() const {
+        return height;
+    }
+
 private:
-    Zoom(const Shape<T>& shape_, DiverT diver_, const Scaler<T>& scaler_, ColorerT colorer_,
-        int width_, int height_): shape(shape_), diver(diver_), scaler(scaler_), colorer(colorer_),
-        width(width_), height(height_) {
+    Zoom(std::shared_ptr<const Shape<T>> shape_, DiverT diver_,
+        std::shared_ptr<const Scaler<T>> scaler_, ColorerT colorer_,
+        int width_, int height_): shape(shape_), diver(diver_), scaler(scaler_),
+        colorer(colorer_), width(width_), height(height_) {
 
         Mobius<T> acc;
-        int k = diver.chooseDive(acc);
-        bool inverseDive = (k>=3);
-        std::vector<int> diveIndices;
+        int k = diver.DiverT::chooseDive(acc);
+        inverseDive = (k>=3);
         diveIndices.push_back(k);
-        auto pts = shape.startingPoints(inverseDive);
-        auto arr = shape.diveArray(inverseDive);
+        auto pts = shape->startingPoints(inverseDive);
+        auto arr = shape->diveArray(inverseDive);
         acc = acc.compose(arr[k%3]);
-        std::vector<Mobius<T>> zoomTransforms;
         zoomTransforms.push_back(acc);
-        for (int i=0; i<diver.getDepth()-1; i++) {
-            int k = diver.chooseDive(acc);
+        int depth = diver.DiverT::getDepth();
+        for (int i=0; i<depth-1; i++) {
+            int k = diver.DiverT::chooseDive(acc);
             diveIndices.push_back(k);
             acc = acc.compose(arr[k]);
             zoomTransforms.push_back(acc);
         }
-        auto center = (acc.apply(pts[0])+acc.apply(pts[1])+acc.apply(pts[2]))/Complex<T>(3);
+        center = (acc.apply(pts[0])+acc.apply(pts[1])+acc.apply(pts[2]))/Complex<T>(3);
 
-        T ar(width, height);
-        ar.canonicalize();
-
-        Searcher<T> searcher(shape, scaler, center, inverseDive, zoomTransforms, keyGaskets, ar);
+        ar = fromRatio<T>(width, height);
+    }
+    Zoom(std::shared_ptr<const Shape<T>> shape_, DiverT diver_,
+        std::shared_ptr<const Scaler<T>> scaler_, ColorerT colorer_,
+        int width_, int height_, const Scheduling& scheduling_):
+        Zoom(shape_, diver_, scaler_, colorer_, width_, height_) {
 
-        searcher.start();
+        scheduling = scheduling_;
+        auto pool = scheduling.makePool();
+        auto searcher = startSearch(*pool);
+        finishSearch(*searcher);
+    }
+    std::unique_ptr<Searcher<T>> startSearch(WorkerPool& pool, int firstLevel = 0) {
+        auto searcher = std::make_unique<Searcher<T>>(*shape, *scaler, center, inverseDive,
+            zoomTransforms, keyGaskets, ar, pool.get(), pool.size());
+        searcher->start(firstLevel);
+        return searcher;
+    }
+    void finishSearch(Searcher<T>& searcher) {
         searcher.block();
 
-        colorer.keyGaskets(keyGaskets);
+        colorer.ColorerT::keyGaskets(keyGaskets);
 
+        diveIndicesMap.clear();
         for (auto g: keyGaskets) {
-            diveIndicesMap[g.first] = diveIndices[g.second.level+1];
+            int next = g.second.level+1;
+            diveIndicesMap[g.first] = (next < diveIndices.size()) ? diveIndices[next] : -1;
         }
     }
-    const Shape<T>& shape;
+    // Largest on-screen shift, in half screen heights, that an extension may
+    // apply to an existing key without searching its level again.
+    static constexpr double MAX_CENTER_SHIFT = 1e-6;
+
+    std::shared_ptr<const Shape<T>> shape;
     DiverT diver;
-    const Scaler<T>& scaler;
+    std::shared_ptr<const Scaler<T>> scaler;
     ColorerT colorer;
     int width, height;
+    Scheduling scheduling;
+    bool inverseDive;
+    Complex<T> center;
+    T ar;
+    std::vector<int> diveIndices;
+    std::vector<Mobius<T>> zoomTransforms;
     std::map<double, KeyGasket> keyGaskets;
     std::map<double, int> diveIndicesMap;
 };
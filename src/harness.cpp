@@ -0,0 +1,289 @@
+#include <chrono>
+#include <cinttypes>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+#include "gasket/zoom.hpp"
+
+using std::map;
+using std::string;
+using std::vector;
+
+// Builds the same zoom with every scalar type Zoom supports and compares the
+// resulting keyframes level by level against the exact mpq_class reference.
+// Each build runs in its own child process so wall time and peak resident
+// memory are measured per type.
+
+template<typename T>
+class DiverImpl final : public gasket::Diver<T> {
+public:
+    DiverImpl(int depth_, int seed): depth(depth_), rng(seed), dist2(0,1), dist3(0,2) {
+
+    }
+    int chooseDive(const gasket::Mobius<T>& acc) const {
+        if (acc.a == gasket::Complex<T>(1) && acc.b == gasket::Complex<T>(0) &&
+            acc.c == gasket::Complex<T>(0) && acc.d == gasket::Complex<T>(1)) {
+
+            int k = dist2(rng);
+            return k*3 + dist3(rng);
+        }
+        return dist3(rng);
+    }
+    int getDepth() const {
+        return depth;
+    }
+private:
+    int depth;
+    mutable std::mt19937 rng;
+    mutable std::uniform_int_distribution<std::mt19937::result_type> dist2, dist3;
+};
+
+class ColorerImpl final : public gasket::Colorer {
+public:
+    void keyGaskets(const map<double, gasket::KeyGasket>& keyGaskets) { }
+    gasket::ColorParams color(double logscale, int diveTransform) const {
+        return gasket::ColorParams();
+    }
+};
+
+struct Params {
+    int depth = 40;
+    int seed = 314159;
+    int numSteps = 22050;
+    int width = 480;
+    int height = 270;
+};
+
+struct Key {
+    double logscale;
+    vector<gasket::Mobius<double>> transforms;
+};
+
+struct Result {
+    string name;
+    bool ok = false;
+    string error;
+    double seconds = 0;
+    long maxRssKb = 0;
+    map<int, Key> keys;
+};
+
+template <typename T>
+map<int, Key> buildKeys(const Params& p) {
+    typedef gasket::Zoom<T, DiverImpl<T>, ColorerImpl> GasketZoom;
+    const GasketZoom gz = typename GasketZoom::Builder()
+        .withShape(gasket::fromRatio<T>(6,11), gasket::fromRatio<T>(3,7),
+            gasket::Complex<T>(1))
+        .withScales(gasket::fromRatio<T>(-50,150), gasket::fromRatio<T>(1,150), p.numSteps)
+        .withImageSize(p.width, p.height)
+        .build(DiverImpl<T>(p.depth, p.seed), ColorerImpl());
+    map<int, Key> keys;
+    for (auto& g: gz.getKeyGaskets()) {
+        keys[g.second.level] = Key{g.first, g.second.getTransforms()};
+    }
+    return keys;
+}
+
+bool writeAll(int fd, const void* data, size_t size) {
+    const char* p = static_cast<const char*>(data);
+    while (size > 0) {
+        ssize_t n = write(fd, p, size);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Child side: status byte, elapsed seconds, then the keys, or an error text.
+template <typename T>
+void runChild(int fd, const Params& p) {
+    try {
+        auto t0 = std::chrono::steady_clock::now();
+        auto keys = buildKeys<T>(p);
+        double seconds = std::chrono::duration<double>(
+            std::chrono::steady_clock::now() - t0).count();
+        char status = 1;
+        writeAll(fd, &status, 1);
+        writeAll(fd, &seconds, sizeof(seconds));
+        for (auto& k: keys) {
+            int32_t header[2] = {k.first, (int32_t)k.second.transforms.size()};
+            writeAll(fd, header, sizeof(header));
+            writeAll(fd, &k.second.logscale, sizeof(double));
+            for (auto& t: k.second.transforms) {
+                double c[8] = {t.a.real, t.a.imag, t.b.real, t.b.imag,
+                    t.c.real, t.c.imag, t.d.real, t.d.imag};
+                writeAll(fd, c, sizeof(c));
+            }
+        }
+    } catch (const std::exception& e) {
+        char status = 0;
+        writeAll(fd, &status, 1);
+        writeAll(fd, e.what(), strlen(e.what()));
+    }
+}
+
+template <typename T>
+Result run(const string& name, const Params& p) {
+    Result result;
+    result.name = name;
+    int fds[2];
+    if (pipe(fds) < 0) {
+        result.error = "pipe failed";
+        return result;
+    }
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) {
+        close(fds[0]);
+        close(fds[1]);
+        result.error = "fork failed";
+        return result;
+    }
+    if (pid == 0) {
+        close(fds[0]);
+        runChild<T>(fds[1], p);
+        close(fds[1]);
+        _exit(0);
+    }
+    close(fds[1]);
+    string data;
+    char buf[1 << 16];
+    ssize_t n;
+    while ((n = read(fds[0], buf, sizeof(buf))) > 0) {
+        data.append(buf, n);
+    }
+    close(fds[0]);
+
+    int status;
+    struct rusage usage;
+    wait4(pid, &status, 0, &usage);
+    result.maxRssKb = usage.ru_maxrss;
+    if (data.empty()) {
+        result.error = "child exited without a result";
+        return result;
+    }
+    if (data[0] == 0) {
+        result.error = data.substr(1);
+        return result;
+    }
+    size_t pos = 1;
+    auto take = [&](void* dst, size_t size) {
+        if (pos + size > data.size()) {
+            return false;
+        }
+        memcpy(dst, data.data() + pos, size);
+        pos += size;
+        return true;
+    };
+    take(&result.seconds, sizeof(double));
+    int32_t header[2];
+    while (take(header, sizeof(header))) {
+        Key key;
+        take(&key.logscale, sizeof(double));
+        for (int i=0; i<header[1]; i++) {
+            double c[8];
+            take(c, sizeof(c));
+            key.transforms.emplace_back(gasket::Complex<double>(c[0], c[1]),
+                gasket::Complex<double>(c[2], c[3]), gasket::Complex<double>(c[4], c[5]),
+                gasket::Complex<double>(c[6], c[7]));
+        }
+        result.keys[header[0]] = key;
+    }
+    result.ok = true;
+    return result;
+}
+
+// Mobius coefficients are only defined up to a common factor, so both maps are
+// normalized to unit determinant and compared up to sign.
+double deviation(gasket::Mobius<double> x, gasket::Mobius<double> y) {
+    x.normalize();
+    y.normalize();
+    double plus = 0, minus = 0;
+    gasket::Complex<double> xs[4] = {x.a, x.b, x.c, x.d};
+    gasket::Complex<double> ys[4] = {y.a, y.b, y.c, y.d};
+    for (int i=0; i<4; i++) {
+        plus = std::max(plus, sqrt((xs[i] - ys[i]).norm()));
+        minus = std::max(minus, sqrt((xs[i] + ys[i]).norm()));
+    }
+    return std::min(plus, minus);
+}
+
+int main(int argc, char* argv[]) {
+    Params p;
+    if (argc > 1) p.depth = atoi(argv[1]);
+    if (argc > 2) p.seed = atoi(argv[2]);
+    if (argc > 3) p.numSteps = atoi(argv[3]);
+    if (argc > 4 || p.depth <= 0 || p.numSteps <= 0) {
+        fprintf(stderr, "usage: %s [depth] [seed] [numSteps]\n", argv[0]);
+        return 1;
+    }
+
+    vector<Result> results;
+    results.push_back(run<mpq_class>("mpq_class", p));
+    results.push_back(run<long double>("long double", p));
+    results.push_back(run<double>("double", p));
+
+    printf("depth %d, seed %d, %d scale steps\n\n", p.depth, p.seed, p.numSteps);
+    printf("%-12s %10s %12s %6s\n", "type", "seconds", "peak RSS kB", "keys");
+    for (auto& r: results) {
+        if (r.ok) {
+            printf("%-12s %10.3f %12ld %6zu\n", r.name.c_str(), r.seconds, r.maxRssKb,
+                r.keys.size());
+        } else {
+            printf("%-12s failed: %s\n", r.name.c_str(), r.error.c_str());
+        }
+    }
+    const Result& ref = results[0];
+    if (!ref.ok) {
+        return 1;
+    }
+
+    printf("\nmaximum deviation from %s per level (logscale / coefficients)\n",
+        ref.name.c_str());
+    printf("%6s %10s", "level", "logscale");
+    for (size_t i=1; i<results.size(); i++) {
+        printf(" %25s", results[i].name.c_str());
+    }
+    printf("\n");
+    for (auto& k: ref.keys) {
+        printf("%6d %10.4f", k.first, k.second.logscale);
+        for (size_t i=1; i<results.size(); i++) {
+            auto it = results[i].keys.find(k.first);
+            if (!results[i].ok || it == results[i].keys.end()) {
+                printf(" %25s", "missing");
+                continue;
+            }
+            double dLogscale = fabs(it->second.logscale - k.second.logscale);
+            double dCoef = 0;
+            if (it->second.transforms.size() != k.second.transforms.size()) {
+                dCoef = INFINITY;
+            } else {
+                for (size_t j=0; j<k.second.transforms.size(); j++) {
+                    dCoef = std::max(dCoef,
+                        deviation(it->second.transforms[j], k.second.transforms[j]));
+                }
+            }
+            printf("     %9.3g / %9.3g", dLogscale, dCoef);
+        }
+        printf("\n");
+    }
+    for (size_t i=1; i<results.size(); i++) {
+        for (auto& k: results[i].keys) {
+            if (ref.keys.count(k.first) == 0) {
+                printf("%s has an extra key at level %d\n", results[i].name.c_str(), k.first);
+            }
+        }
+    }
+    return 0;
+}
@@ -7,18 +7,20 @@
 #include <memory>
 #include <random>
 #include <vector>
+#include "gasket/exporter.hpp"
 #include "gasket/zoom.hpp"
+#include "render/worker.hpp"
 
 using boost::gil::rgb8_pixel_t;
 using std::map;
 
 template<typename T>
-class DiverImpl : public gasket::Diver<T> {
+class DiverImpl final : public gasket::Diver<T> {
 public:
     DiverImpl(int depth_, int seed): depth(depth_), rng(seed), dist2(0,1), dist3(0,2) {
 
     }
-    int chooseDive(gasket::Mobius<T> acc) const {
+    int chooseDive(const gasket::Mobius<T>& acc) const {
         if (acc.a == gasket::Complex<T>(1) && acc.b == gasket::Complex<T>(0) &&
             acc.c == gasket::Complex<T>(0) && acc.d == gasket::Complex<T>(1)) {
 
@@ -36,7 +38,7 @@ private:
     mutable std::uniform_int_distribution<std::mt19937::result_type> dist2, dist3;
 };
 
-class ColorerImpl: public gasket::Colorer {
+class ColorerImpl final : public gasket::Colorer {
 public:
     ColorerImpl() { }
     void keyGaskets(const map<double, gasket::KeyGasket>& keyGaskets) {
@@ -77,6 +79,9 @@ const rgb8_pixel_t ColorerImpl::WHITE = rgb8_pixel_t(255,255,255);
 using std::string;
 
 int main(int argc, char* argv[]) {
+    if (argc == 3 && string(argv[1]) == "--worker") {
+        return render::Worker(argv[2]).run();
+    }
     /*
         DiverImpl<mpq_class> diver(200, 314159);
         ColorerImpl colorer;
@@ -87,19 +92,10 @@ int main(int argc, char* argv[]) {
             .withImageSize(480, 270)
             .build(diver, colorer);
 
-        for (int i=0; i<900; i++) {
-            tinyxml2::XMLDocument xmlDoc;
-            auto node = gz.getFlame(20+i*1./150).toXMLNode(xmlDoc);
-            xmlDoc.InsertFirstChild(node);
-            std::ostringstream ss;
-            ss<<"/home/felipe/zoom/frame"<<std::setfill('0')<<std::setw(3)<<i<<".flame";
-            xmlDoc.SaveFile(ss.str().c_str());
-        }
-
-        tinyxml2::XMLDocument xmlDoc;
-        auto flame = gz.getFlame(3, 10);
-        auto node = flame.toXMLNode(xmlDoc);
-        xmlDoc.InsertFirstChild(node);
-        xmlDoc.SaveFile(stdout);*/
+        gasket::FlameExporter exporter([&](int i) {
+            return gz.getFlame(20+i*1./150);
+        }, 900);
+        exporter.writeXmlFiles("/home/felipe/zoom/frame");
+        exporter.writeBinary("/home/felipe/zoom/frames.bin");*/
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,231 @@
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "checkpoint.hpp"
+
+namespace render {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+const char MAGIC[8] = "GASKHST";
+const uint32_t VERSION = 3;
+const size_t ALIGNMENT = 4096;
+
+size_t align(size_t n) {
+    return (n + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT;
+}
+
+}
+
+MappedHistogram::MappedHistogram(const string& path, int width, int height, int numStreams,
+    uint64_t seed): MappedHistogram(map(path, width, height, numStreams, seed), width, height) {
+
+}
+
+MappedHistogram::MappedHistogram(const Mapping& mapping_, int width, int height):
+    Histogram(width, height, (Bucket*)(mapping_.base +
+        bucketOffset(width, height, ((Header*)mapping_.base)->numStreams)),
+        &((Header*)mapping_.base)->samples),
+    mapping(mapping_), header((Header*)mapping_.base) {
+
+    if (header->journalValid) {
+        try {
+            replay();
+        } catch (...) {
+            munmap(mapping.base, mapping.size);
+            close(mapping.fd);
+            throw;
+        }
+    }
+}
+
+MappedHistogram::~MappedHistogram() {
+    munmap(mapping.base, mapping.size);
+    close(mapping.fd);
+}
+
+MappedHistogram::Mapping MappedHistogram::map(const string& path, int width, int height,
+    int numStreams, uint64_t seed) {
+
+    if (width <= 0 || height <= 0 || numStreams <= 0) {
+        throw std::invalid_argument("Invalid checkpoint dimensions.");
+    }
+    size_t size = bucketOffset(width, height, numStreams) +
+        align((size_t)width*height*sizeof(Bucket));
+    int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open checkpoint " + path + ".");
+    }
+    struct stat st;
+    bool fresh = (fstat(fd, &st) == 0 && st.st_size == 0);
+    if (fresh && ftruncate(fd, size) < 0) {
+        close(fd);
+        throw std::runtime_error("Could not size checkpoint " + path + ".");
+    }
+    if (!fresh && st.st_size != size) {
+        close(fd);
+        throw std::runtime_error("Checkpoint " + path + " does not match render size.");
+    }
+    void* base = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (base == MAP_FAILED) {
+        close(fd);
+        throw std::runtime_error("Could not map checkpoint " + path + ".");
+    }
+    Header* header = (Header*)base;
+    string error;
+    if (fresh) {
+        // The stream states are made durable before the magic that marks the
+        // file as a checkpoint.
+        header->version = VERSION;
+        header->width = width;
+        header->height = height;
+        header->numStreams = numStreams;
+        uint64_t* states = (uint64_t*)(header + 1);
+        for (int i=0; i<numStreams; i++) {
+            states[i] = Rng::forStream(seed, i).getState();
+        }
+        if (msync(base, journalOffset(numStreams), MS_SYNC) < 0) {
+            error = "could not be synced";
+        } else {
+            memcpy(header->magic, MAGIC, sizeof(MAGIC));
+            if (msync(base, ALIGNMENT, MS_SYNC) < 0) {
+                error = "could not be synced";
+            }
+        }
+    } else if (memcmp(header->magic, MAGIC, sizeof(MAGIC)) != 0 ||
+        header->version != VERSION) {
+
+        error = "is not a histogram checkpoint";
+    } else if (header->width != width || header->height != height ||
+        header->numStreams != numStreams) {
+
+        error = "does not match render parameters";
+    } else if (header->journalValid) {
+        auto journal = (const JournalHeader*)((char*)base + journalOffset(numStreams));
+        auto entries = (const JournalEntry*)((const uint64_t*)(journal + 1) + numStreams);
+        uint64_t numBuckets = (uint64_t)width*height;
+        bool valid = journal->numEntries <= numBuckets;
+        for (uint64_t i=0; valid && i<journal->numEntries; i++) {
+            valid = entries[i].index < numBuckets;
+        }
+        if (!valid) {
+            error = "has a corrupt journal";
+        }
+    }
+    if (!error.empty()) {
+        munmap(base, size);
+        close(fd);
+        throw std::runtime_error("Checkpoint " + path + " " + error + ".");
+    }
+    return Mapping{fd, size, (char*)base};
+}
+
+size_t MappedHistogram::journalOffset(int numStreams) {
+    return align(sizeof(Header) + numStreams*sizeof(uint64_t));
+}
+
+size_t MappedHistogram::bucketOffset(int width, int height, int numStreams) {
+    return journalOffset(numStreams) + align(sizeof(JournalHeader) +
+        numStreams*sizeof(uint64_t) + (size_t)width*height*sizeof(JournalEntry));
+}
+
+uint64_t* MappedHistogram::streamStates() const {
+    return (uint64_t*)(header + 1);
+}
+
+MappedHistogram::JournalHeader* MappedHistogram::journal() const {
+    return (JournalHeader*)(mapping.base + journalOffset(header->numStreams));
+}
+
+uint64_t* MappedHistogram::journalStates() const {
+    return (uint64_t*)(journal() + 1);
+}
+
+MappedHistogram::JournalEntry* MappedHistogram::journalEntries() const {
+    return (JournalEntry*)(journalStates() + header->numStreams);
+}
+
+// msync needs a page-aligned start.
+void MappedHistogram::sync(size_t offset, size_t size) const {
+    size_t start = offset / ALIGNMENT * ALIGNMENT;
+    if (msync(mapping.base + start, offset + size - start, MS_SYNC) < 0) {
+        throw std::runtime_error("Could not sync checkpoint.");
+    }
+}
+
+// Applies a valid journal. Entries hold new values rather than increments, so
+// replaying a journal that was partly applied before a crash is harmless.
+void MappedHistogram::replay() {
+    const JournalHeader* j = journal();
+    const JournalEntry* entries = journalEntries();
+    Bucket* buckets = data();
+    for (uint64_t i=0; i<j->numEntries; i++) {
+        buckets[entries[i].index] = entries[i].value;
+    }
+    header->samples = j->samples;
+    std::copy_n(journalStates(), header->numStreams, streamStates());
+    sync(bucketOffset(width, height, header->numStreams), (size_t)size()*sizeof(Bucket));
+    sync(0, journalOffset(header->numStreams));
+    header->journalValid = 0;
+    sync(0, sizeof(Header));
+}
+
+vector<Rng> MappedHistogram::getStreams() const {
+    vector<Rng> streams;
+    for (int i=0; i<header->numStreams; i++) {
+        streams.push_back(Rng(streamStates()[i]));
+    }
+    return streams;
+}
+
+void MappedHistogram::commit(const Histogram& chunk, const vector<Rng>& streams) {
+    if (streams.size() != header->numStreams) {
+        throw std::invalid_argument("Stream count does not match checkpoint.");
+    }
+    if (chunk.width != width || chunk.height != height) {
+        throw std::invalid_argument("Chunk size does not match checkpoint.");
+    }
+    JournalHeader* j = journal();
+    JournalEntry* entries = journalEntries();
+    const Bucket* added = chunk.data();
+    const Bucket* buckets = data();
+    uint64_t n = 0;
+    for (int i=0; i<size(); i++) {
+        if (added[i].count != 0) {
+            entries[n++] = {(uint64_t)i, {buckets[i].count + added[i].count,
+                buckets[i].color + added[i].color}};
+        }
+    }
+    j->samples = header->samples + chunk.getSamples();
+    j->numEntries = n;
+    for (int i=0; i<streams.size(); i++) {
+        journalStates()[i] = streams[i].getState();
+    }
+    sync(journalOffset(header->numStreams), (char*)(entries + n) - (char*)j);
+    header->journalValid = 1;
+    sync(0, sizeof(Header));
+    replay();
+}
+
+void renderResumable(const Renderer& renderer, const gasket::Flame& flame,
+    MappedHistogram& histogram, uint64_t totalSamples, uint64_t checkpointInterval) {
+
+    auto streams = histogram.getStreams();
+    Histogram chunk(histogram.width, histogram.height);
+    uint64_t interval = std::max<uint64_t>(checkpointInterval, 1);
+    while (histogram.getSamples() < totalSamples) {
+        uint64_t n = std::min(interval, totalSamples - histogram.getSamples());
+        renderer.render(flame, chunk, n, streams);
+        histogram.commit(chunk, streams);
+        chunk.clear();
+    }
+}
+
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "../gasket/flame.hpp"
+#include "histogram.hpp"
+#include "renderer.hpp"
+#include "rng.hpp"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace render {
+
+// Histogram backed by a file holding the committed sample count, random
+// stream states and buckets, plus a redo journal. commit() journals the new
+// value of every cell a chunk touched, marks the journal valid, and only then
+// updates the buckets in place; reopening replays a valid journal, so a crash
+// at any point leaves the last commit intact.
+class MappedHistogram : public Histogram {
+public:
+    MappedHistogram(const std::string& path, int width, int height, int numStreams,
+        uint64_t seed);
+    ~MappedHistogram();
+    std::vector<Rng> getStreams() const;
+    // Adds chunk, rendered since the last commit, and the streams' states.
+    void commit(const Histogram& chunk, const std::vector<Rng>& streams);
+private:
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        int32_t width, height;
+        int32_t numStreams;
+        uint64_t samples;
+        uint64_t journalValid;
+    };
+    struct JournalHeader {
+        uint64_t samples;
+        uint64_t numEntries;
+    };
+    struct JournalEntry {
+        uint64_t index;
+        Bucket value;
+    };
+    struct Mapping {
+        int fd;
+        size_t size;
+        char* base;
+    };
+
+    MappedHistogram(const Mapping& mapping, int width, int height);
+    static Mapping map(const std::string& path, int width, int height, int numStreams,
+        uint64_t seed);
+    static size_t journalOffset(int numStreams);
+    static size_t bucketOffset(int width, int height, int numStreams);
+    uint64_t* streamStates() const;
+    JournalHeader* journal() const;
+    uint64_t* journalStates() const;
+    JournalEntry* journalEntries() const;
+    void replay();
+    void sync(size_t offset, size_t size) const;
+
+    Mapping mapping;
+    Header* header;
+};
+
+// Renders until the histogram holds totalSamples, committing every
+// checkpointInterval samples.
+void renderResumable(const Renderer& renderer, const gasket::Flame& flame,
+    MappedHistogram& histogram, uint64_t totalSamples, uint64_t checkpointInterval);
+
+}
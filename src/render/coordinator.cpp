@@ -0,0 +1,257 @@
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "../gasket/scheduling.hpp"
+#include "coordinator.hpp"
+#include "protocol.hpp"
+#include "worker.hpp"
+
+namespace render {
+
+using gasket::Flame;
+using std::string;
+using std::vector;
+
+Coordinator::Coordinator(const string& socketPath_, const RenderJob& job_, int numWorkers_,
+    int rangeSize_, int maxAttempts_): socketPath(socketPath_), job(job_),
+    numWorkers(numWorkers_), rangeSize(rangeSize_), maxAttempts(maxAttempts_) {
+
+    if (socketPath.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::invalid_argument("Socket path too long.");
+    }
+    if (numWorkers < 0 || rangeSize <= 0 || maxAttempts <= 0) {
+        throw std::invalid_argument("Invalid coordinator parameters.");
+    }
+    // Forked workers share this machine, so a job that leaves the thread
+    // count to the worker gets its cores split between them.
+    localThreads = std::max(1, gasket::availableCores() / std::max(numWorkers, 1));
+}
+
+void Coordinator::run(const vector<Flame>& flames_, FrameCallback onFrame) {
+    flames = &flames_;
+    int numFrames = flames->size();
+    queue.clear();
+    for (int i=0; i<numFrames; i++) {
+        queue.push_back(i);
+    }
+    attempts.assign(numFrames, 0);
+    finished.assign(numFrames, false);
+    numFinished = 0;
+    respawnsLeft = maxAttempts*std::max(numWorkers, 1);
+
+    listen();
+    try {
+        for (int i=0; i<numWorkers; i++) {
+            spawnWorker();
+        }
+        while (numFinished < numFrames) {
+            reapWorkers();
+            vector<pollfd> fds;
+            fds.push_back({listenFd, POLLIN, 0});
+            for (auto& c: connections) {
+                fds.push_back({c.first, POLLIN, 0});
+            }
+            if (poll(fds.data(), fds.size(), 200) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Coordinator poll failed.");
+            }
+            if (fds[0].revents & POLLIN) {
+                accept();
+            }
+            for (int i=1; i<fds.size(); i++) {
+                if (fds[i].revents & (POLLIN | POLLHUP | POLLERR)) {
+                    receive(fds[i].fd, onFrame);
+                }
+            }
+            vector<int> idle;
+            for (auto& c: connections) {
+                if (c.second.assigned.empty()) {
+                    idle.push_back(c.first);
+                }
+            }
+            for (int fd: idle) {
+                assign(fd);
+            }
+        }
+    } catch (...) {
+        shutdown(false);
+        throw;
+    }
+    shutdown(true);
+}
+
+void Coordinator::listen() {
+    listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) {
+        throw std::runtime_error("Could not create coordinator socket.");
+    }
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    socketPath.copy(addr.sun_path, socketPath.size());
+    unlink(socketPath.c_str());
+    if (bind(listenFd, (sockaddr*)&addr, sizeof(addr)) < 0 ||
+        ::listen(listenFd, numWorkers + 16) < 0) {
+
+        close(listenFd);
+        listenFd = -1;
+        throw std::runtime_error("Could not listen on " + socketPath + ".");
+    }
+}
+
+void Coordinator::spawnWorker() {
+    pid_t pid = fork();
+    if (pid < 0) {
+        throw std::runtime_error("Could not fork worker.");
+    }
+    if (pid == 0) {
+        close(listenFd);
+        for (auto& c: connections) {
+            close(c.first);
+        }
+        // Nothing may unwind out of the child into the caller's code.
+        try {
+            _exit(Worker(socketPath, localThreads).run());
+        } catch (...) {
+            _exit(1);
+        }
+    }
+    spawned.push_back(pid);
+}
+
+void Coordinator::reapWorkers() {
+    for (int i=0; i<spawned.size();) {
+        int status;
+        if (waitpid(spawned[i], &status, WNOHANG) == spawned[i]) {
+            spawned.erase(spawned.begin() + i);
+            if (respawnsLeft-- <= 0) {
+                throw std::runtime_error("Workers keep dying, giving up.");
+            }
+            spawnWorker();
+        } else {
+            i++;
+        }
+    }
+}
+
+void Coordinator::accept() {
+    int fd = ::accept(listenFd, nullptr, nullptr);
+    if (fd < 0) {
+        return;
+    }
+    Encoder enc;
+    encodeJob(enc, job);
+    if (!sendMessage(fd, MessageType::Job, enc.data)) {
+        close(fd);
+        return;
+    }
+    connections[fd] = Connection{fd, {}};
+}
+
+void Coordinator::assign(int fd) {
+    Connection& conn = connections.at(fd);
+    Encoder enc;
+    while (!queue.empty() && conn.assigned.size() < rangeSize) {
+        conn.assigned.push_back(queue.front());
+        queue.pop_front();
+    }
+    if (conn.assigned.empty()) {
+        return;
+    }
+    enc.put<uint32_t>(conn.assigned.size());
+    for (int index: conn.assigned) {
+        enc.put<uint32_t>(index);
+        encodeFlame(enc, (*flames)[index]);
+    }
+    if (!sendMessage(fd, MessageType::Range, enc.data)) {
+        drop(fd);
+    }
+}
+
+void Coordinator::receive(int fd, FrameCallback& onFrame) {
+    MessageType type;
+    string payload;
+    if (!readMessage(fd, type, payload) ||
+        (type != MessageType::Frame && type != MessageType::Failed)) {
+
+        drop(fd);
+        return;
+    }
+    uint32_t index;
+    boost::gil::rgb8_image_t image;
+    try {
+        Decoder dec(payload);
+        index = dec.get<uint32_t>();
+        if (type == MessageType::Frame) {
+            image = decodeImage(dec);
+        }
+    } catch (const std::runtime_error&) {
+        drop(fd);
+        return;
+    }
+    auto& assigned = connections.at(fd).assigned;
+    assigned.erase(std::remove(assigned.begin(), assigned.end(), index), assigned.end());
+    if (index >= finished.size()) {
+        return;
+    }
+    if (type == MessageType::Failed) {
+        retry(index, payload.substr(sizeof(index)));
+        return;
+    }
+    if (!finished[index]) {
+        finished[index] = true;
+        numFinished++;
+        onFrame(index, image);
+    }
+}
+
+void Coordinator::drop(int fd) {
+    auto& assigned = connections.at(fd).assigned;
+    for (auto it = assigned.rbegin(); it != assigned.rend(); it++) {
+        retry(*it, "");
+    }
+    close(fd);
+    connections.erase(fd);
+}
+
+void Coordinator::retry(int index, const string& error) {
+    if (finished[index]) {
+        return;
+    }
+    if (++attempts[index] >= maxAttempts) {
+        throw std::runtime_error("Frame " + std::to_string(index) +
+            " failed on too many workers" + (error.empty() ? "." : ": " + error));
+    }
+    queue.push_front(index);
+}
+
+void Coordinator::shutdown(bool graceful) {
+    for (auto& c: connections) {
+        if (graceful) {
+            sendMessage(c.first, MessageType::Shutdown, "");
+        }
+        close(c.first);
+    }
+    connections.clear();
+    if (listenFd >= 0) {
+        close(listenFd);
+        listenFd = -1;
+        unlink(socketPath.c_str());
+    }
+    for (pid_t pid: spawned) {
+        if (!graceful) {
+            kill(pid, SIGTERM);
+        }
+        waitpid(pid, nullptr, 0);
+    }
+    spawned.clear();
+}
+
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "../gasket/flame.hpp"
+#include "job.hpp"
+#include <boost/gil.hpp>
+#include <deque>
+#include <functional>
+#include <map>
+#include <string>
+#include <sys/types.h>
+#include <vector>
+
+namespace render {
+
+class Coordinator {
+public:
+    typedef std::function<void(int, const boost::gil::rgb8_image_t&)> FrameCallback;
+
+    Coordinator(const std::string& socketPath, const RenderJob& job, int numWorkers,
+        int rangeSize = 8, int maxAttempts = 3);
+    void run(const std::vector<gasket::Flame>& flames, FrameCallback onFrame);
+private:
+    struct Connection {
+        int fd;
+        std::vector<int> assigned;
+    };
+
+    void listen();
+    void spawnWorker();
+    void reapWorkers();
+    void accept();
+    void assign(int fd);
+    void receive(int fd, FrameCallback& onFrame);
+    void drop(int fd);
+    void retry(int index, const std::string& error);
+    void shutdown(bool graceful);
+
+    std::string socketPath;
+    RenderJob job;
+    int numWorkers, rangeSize, maxAttempts;
+    int localThreads;
+    int listenFd = -1;
+    int respawnsLeft;
+    const std::vector<gasket::Flame>* flames = nullptr;
+    std::deque<int> queue;
+    std::vector<int> attempts;
+    std::vector<bool> finished;
+    int numFinished = 0;
+    std::vector<pid_t> spawned;
+    std::map<int, Connection> connections;
+};
+
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+namespace render {
+
+enum class AccumFormat {
+    Double,
+    CountFloat,
+    Float
+};
+
+struct Bucket {
+    double count = 0;
+    double color = 0;
+};
+
+class Histogram {
+public:
+    Histogram(int width_, int height_): width(width_), height(height_),
+        storage(width_*height_), buckets(storage.data()), samples(&ownSamples) { }
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+    virtual ~Histogram() { }
+    Bucket* data() {
+        return buckets;
+    }
+    const Bucket* data() const {
+        return buckets;
+    }
+    int size() const {
+        return width*height;
+    }
+    uint64_t getSamples() const {
+        return *samples;
+    }
+    void addSamples(uint64_t n) {
+        *samples += n;
+    }
+    void clear() {
+        std::fill(buckets, buckets + size(), Bucket());
+        *samples = 0;
+    }
+    const int width, height;
+protected:
+    Histogram(int width_, int height_, Bucket* buckets_, uint64_t* samples_):
+        width(width_), height(height_), buckets(buckets_), samples(samples_) { }
+private:
+    std::vector<Bucket> storage;
+    uint64_t ownSamples = 0;
+    Bucket* buckets;
+    uint64_t* samples;
+};
+
+// Per-stream accumulation buffer. Cells live in one zeroed allocation whose
+// pages stay untouched until a sample lands on them, and a cell is recorded
+// when its count leaves zero, so a flush only visits cells written since the
+// last one. Sparse frames thus cost neither memory nor flush bandwidth for
+// their empty regions.
+template <typename CountT, typename ColorT>
+class ScatterBuffer {
+public:
+    ScatterBuffer(int size_): size(size_),
+        cells((Cell*)std::calloc(size_, sizeof(Cell))) {
+
+        if (!cells) {
+            throw std::bad_alloc();
+        }
+    }
+    // Samples a buffer can take before a cell may lose precision. Past 2^24 a
+    // float count stops incrementing and a float colour sum no longer moves
+    // when a colour in [0, 1] is added. Every sample may land in one cell, so
+    // the bound applies to the whole buffer.
+    static constexpr uint64_t maxSamples() {
+        if (std::is_same<CountT, float>::value || std::is_same<ColorT, float>::value) {
+            return (uint64_t)1 << 24;
+        }
+        return UINT64_MAX;
+    }
+    void add(int idx, double color) {
+        Cell& cell = cells.get()[idx];
+        if (cell.count == 0) {
+            touched.push_back(idx);
+        }
+        cell.count += 1;
+        cell.color += color;
+    }
+    void flushInto(Histogram& histogram) {
+        Bucket* buckets = histogram.data();
+        Cell* c = cells.get();
+        if (touched.size() > size / DENSE_FRACTION) {
+            for (int i=0; i<size; i++) {
+                flushCell(buckets[i], c[i]);
+            }
+        } else {
+            for (int i: touched) {
+                flushCell(buckets[i], c[i]);
+            }
+        }
+        touched.clear();
+    }
+private:
+    // Past this share of written cells a sequential sweep beats the scattered
+    // walk over the touched list.
+    static constexpr int DENSE_FRACTION = 4;
+
+    struct Cell {
+        CountT count;
+        ColorT color;
+    };
+    struct Free {
+        void operator()(Cell* p) const {
+            std::free(p);
+        }
+    };
+    static void flushCell(Bucket& bucket, Cell& cell) {
+        bucket.count += cell.count;
+        bucket.color += cell.color;
+        cell = Cell{0, 0};
+    }
+    int size;
+    std::unique_ptr<Cell, Free> cells;
+    std::vector<int> touched;
+};
+
+}
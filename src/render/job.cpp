@@ -0,0 +1,30 @@
+#include "job.hpp"
+#include "renderer.hpp"
+
+namespace render {
+
+using boost::gil::rgb8_image_t;
+
+rgb8_image_t renderFrame(const RenderJob& job, const gasket::Flame& flame, uint64_t seed) {
+    return renderFrame(job, std::vector<gasket::Flame>{flame}, seed);
+}
+
+rgb8_image_t renderFrame(const RenderJob& job, const std::vector<gasket::Flame>& subframes,
+    uint64_t seed) {
+
+    int width = subframes.at(0).width;
+    int height = subframes.at(0).height;
+    Histogram histogram(width, height);
+    Renderer renderer = job.pool ? Renderer(job.pool, job.format) :
+        Renderer(job.format, job.numThreads);
+    renderer.render(subframes, histogram, job.numSamples, seed);
+    rgb8_image_t image(width, height);
+    if (job.pool) {
+        tonemap(histogram, job.palette, job.tone, boost::gil::view(image), *job.pool);
+    } else {
+        tonemap(histogram, job.palette, job.tone, boost::gil::view(image), job.numThreads);
+    }
+    return image;
+}
+
+}
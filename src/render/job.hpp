@@ -0,0 +1,35 @@
+#pragma once
+
+#include "../gasket/flame.hpp"
+#include "../gasket/scheduling.hpp"
+#include "histogram.hpp"
+#include "palette.hpp"
+#include "tonemapper.hpp"
+#include <boost/gil.hpp>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace render {
+
+struct RenderJob {
+    uint64_t numSamples = 1 << 24;
+    uint64_t seed = 0;
+    AccumFormat format = AccumFormat::Double;
+    // Zero uses gasket::availableCores() on the machine rendering the frame;
+    // workers forked by a Coordinator split that count between them.
+    int numThreads = 0;
+    // Pool shared with the search phase; overrides numThreads when set and
+    // is not sent to remote workers.
+    std::shared_ptr<gasket::WorkerPool> pool;
+    ToneParams tone;
+    Palette palette = Palette(boost::gil::rgb8_pixel_t(255, 255, 255),
+        boost::gil::rgb8_pixel_t(255, 0, 0));
+};
+
+boost::gil::rgb8_image_t renderFrame(const RenderJob& job, const gasket::Flame& flame,
+    uint64_t seed);
+boost::gil::rgb8_image_t renderFrame(const RenderJob& job,
+    const std::vector<gasket::Flame>& subframes, uint64_t seed);
+
+}
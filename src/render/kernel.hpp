@@ -0,0 +1,139 @@
+#pragma once
+
+#include "../gasket/mobius.hpp"
+#include "histogram.hpp"
+#include "rng.hpp"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Chaos-game kernel behind Renderer, in a header so that sample colour hooks
+// passed to Renderer::render are inlined into the loop.
+namespace render {
+namespace kernel {
+
+constexpr int FUSE_ITERATIONS = 20;
+constexpr uint64_t CANCEL_CHECK_MASK = (1 << 16) - 1;
+constexpr uint64_t MIN_SUBFRAME_BATCH = 1 << 12;
+constexpr int BATCHES_PER_SUBFRAME = 4;
+
+struct Coefs {
+    double ar, ai, br, bi, cr, ci, dr, di;
+};
+
+inline Coefs toCoefs(const gasket::Mobius<double>& m) {
+    return {m.a.real, m.a.imag, m.b.real, m.b.imag,
+        m.c.real, m.c.imag, m.d.real, m.d.imag};
+}
+
+struct Subframe {
+    std::vector<Coefs> coefs;
+    std::vector<double> colors;
+};
+
+struct Context {
+    int width, height;
+    double halfHeight, ar;
+    uint64_t flushInterval;
+    uint64_t batch;
+    bool refuse;
+    const std::atomic<bool>* cancel;
+};
+
+template <int N>
+struct Transforms {
+    std::array<Coefs, N> coefs;
+    std::array<double, N> colors;
+    void load(const Subframe& sub) {
+        std::copy_n(sub.coefs.begin(), N, coefs.begin());
+        std::copy_n(sub.colors.begin(), N, colors.begin());
+    }
+    int pick(Rng& rng) const {
+        return rng.pick(N);
+    }
+};
+
+template <>
+struct Transforms<0> {
+    const Coefs* coefs;
+    const double* colors;
+    int count;
+    void load(const Subframe& sub) {
+        coefs = sub.coefs.data();
+        colors = sub.colors.data();
+        count = sub.coefs.size();
+    }
+    int pick(Rng& rng) const {
+        return rng.pick(count);
+    }
+};
+
+template <int N, typename CountT, typename ColorT, typename SampleColor, typename Flush>
+void scatter(const std::vector<Subframe>& table, const Context& ctx, int firstSubframe,
+    uint64_t n, Rng& rng, ScatterBuffer<CountT, ColorT>& buffer,
+    const SampleColor& sampleColor, Flush flush) {
+
+    int numSubframes = table.size();
+    int sub = firstSubframe;
+    Transforms<N> tr;
+    tr.load(table[sub]);
+    double x, y, c;
+    int fuse;
+    auto reset = [&] {
+        x = 2*rng.uniform()-1;
+        y = 2*rng.uniform()-1;
+        c = rng.uniform();
+        fuse = FUSE_ITERATIONS;
+    };
+    reset();
+    uint64_t pending = 0;
+    uint64_t batchLeft = ctx.batch;
+    for (uint64_t s=0; s<n;) {
+        int k = tr.pick(rng);
+        const Coefs& m = tr.coefs[k];
+        double nr = m.ar*x - m.ai*y + m.br;
+        double ni = m.ar*y + m.ai*x + m.bi;
+        double dr = m.cr*x - m.ci*y + m.dr;
+        double di = m.cr*y + m.ci*x + m.di;
+        double inv = 1/(dr*dr + di*di);
+        x = (nr*dr + ni*di)*inv;
+        y = (ni*dr - nr*di)*inv;
+        c = (c + tr.colors[k])*0.5;
+        if (!std::isfinite(x) || !std::isfinite(y)) {
+            reset();
+            continue;
+        }
+        if (fuse > 0) {
+            fuse--;
+            continue;
+        }
+        s++;
+        if ((s & CANCEL_CHECK_MASK) == 0 && ctx.cancel && *ctx.cancel) {
+            break;
+        }
+        double px = (x + ctx.ar)*ctx.halfHeight;
+        double py = (1 - y)*ctx.halfHeight;
+        if (px >= 0 && px < ctx.width && py >= 0 && py < ctx.height) {
+            buffer.add((int)py*ctx.width + (int)px, sampleColor(x, y, c));
+        }
+        if (++pending == ctx.flushInterval) {
+            flush(pending);
+            pending = 0;
+        }
+        if (--batchLeft == 0) {
+            sub = (sub + 1) % numSubframes;
+            tr.load(table[sub]);
+            batchLeft = ctx.batch;
+            if (ctx.refuse) {
+                fuse = FUSE_ITERATIONS;
+            }
+        }
+    }
+    flush(pending);
+}
+
+}
+}
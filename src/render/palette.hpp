@@ -0,0 +1,24 @@
+#pragma once
+
+#include <boost/gil.hpp>
+
+namespace render {
+
+class Palette {
+public:
+    Palette(boost::gil::rgb8_pixel_t from_, boost::gil::rgb8_pixel_t to_):
+        from(from_), to(to_) { }
+    double channel(double t, int c) const {
+        return (1-t)*from[c] + t*to[c];
+    }
+    boost::gil::rgb8_pixel_t getFrom() const {
+        return from;
+    }
+    boost::gil::rgb8_pixel_t getTo() const {
+        return to;
+    }
+private:
+    boost::gil::rgb8_pixel_t from, to;
+};
+
+}
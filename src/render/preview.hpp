@@ -0,0 +1,125 @@
+#pragma once
+
+#include "../gasket/zoom.hpp"
+#include "job.hpp"
+#include "renderer.hpp"
+#include "tonemapper.hpp"
+#include <atomic>
+#include <boost/gil.hpp>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+namespace render {
+
+template <typename DiverT, typename ColorerT>
+class Preview {
+public:
+    typedef gasket::Zoom<double, DiverT, ColorerT> PreviewZoom;
+    typedef std::function<void(const boost::gil::rgb8_image_t&, int)> ImageCallback;
+    typedef std::function<void(const std::string&)> ErrorCallback;
+
+    Preview(int width_, int height_, const RenderJob& job_, ImageCallback onImage_,
+        ErrorCallback onError_ = nullptr, int numPasses_ = 4): width(width_),
+        height(height_), job(job_), onImage(onImage_), onError(onError_),
+        numPasses(numPasses_), thread([this] { loop(); }) { }
+
+    ~Preview() {
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            stopping = true;
+            cancelled = true;
+        }
+        wake.notify_all();
+        thread.join();
+    }
+
+    void update(const typename PreviewZoom::Builder& builder, DiverT diver, ColorerT colorer,
+        double logscale) {
+
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            pending.emplace(Request{builder, diver, colorer, logscale});
+            cancelled = true;
+        }
+        wake.notify_all();
+    }
+
+    void cancel() {
+        std::lock_guard<std::mutex> guard(lock);
+        pending.reset();
+        cancelled = true;
+    }
+private:
+    struct Request {
+        typename PreviewZoom::Builder builder;
+        DiverT diver;
+        ColorerT colorer;
+        double logscale;
+    };
+
+    void loop() {
+        std::unique_lock<std::mutex> guard(lock);
+        while (true) {
+            wake.wait(guard, [this] { return stopping || pending; });
+            if (stopping) {
+                return;
+            }
+            Request request = *pending;
+            pending.reset();
+            cancelled = false;
+            guard.unlock();
+            try {
+                run(request);
+            } catch (const std::exception& e) {
+                if (onError) {
+                    onError(e.what());
+                }
+            }
+            guard.lock();
+        }
+    }
+
+    void run(Request& request) {
+        request.builder.withImageSize(width, height);
+        const PreviewZoom zoom = request.builder.build(request.diver, request.colorer);
+        gasket::Flame flame = zoom.getFlame(request.logscale);
+        Renderer renderer = job.pool ? Renderer(job.pool, job.format) :
+            Renderer(job.format, job.numThreads);
+        renderer.setCancelFlag(&cancelled);
+        for (int pass=0; pass<numPasses && !cancelled; pass++) {
+            int shift = numPasses-1-pass;
+            flame.width = std::max(1, width >> shift);
+            flame.height = std::max(1, height >> shift);
+            Histogram histogram(flame.width, flame.height);
+            renderer.render(flame, histogram, job.numSamples >> (2*shift), job.seed);
+            if (cancelled) {
+                return;
+            }
+            boost::gil::rgb8_image_t image(flame.width, flame.height);
+            if (job.pool) {
+                tonemap(histogram, job.palette, job.tone, boost::gil::view(image), *job.pool);
+            } else {
+                tonemap(histogram, job.palette, job.tone, boost::gil::view(image), job.numThreads);
+            }
+            onImage(image, pass);
+        }
+    }
+
+    int width, height;
+    RenderJob job;
+    ImageCallback onImage;
+    ErrorCallback onError;
+    int numPasses;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::optional<Request> pending;
+    std::atomic<bool> cancelled = false;
+    bool stopping = false;
+    std::thread thread;
+};
+
+}
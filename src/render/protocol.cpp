@@ -0,0 +1,166 @@
+#include <sys/socket.h>
+#include <unistd.h>
+#include "protocol.hpp"
+
+namespace render {
+
+using boost::gil::rgb8_image_t;
+using boost::gil::rgb8_pixel_t;
+using gasket::Complex;
+using gasket::Flame;
+using gasket::Mobius;
+
+namespace {
+
+void encodeComplex(Encoder& enc, Complex<double> z) {
+    enc.put(z.real);
+    enc.put(z.imag);
+}
+
+Complex<double> decodeComplex(Decoder& dec) {
+    double real = dec.get<double>();
+    double imag = dec.get<double>();
+    return Complex<double>(real, imag);
+}
+
+void encodePixel(Encoder& enc, rgb8_pixel_t p) {
+    enc.put<uint8_t>(p[0]);
+    enc.put<uint8_t>(p[1]);
+    enc.put<uint8_t>(p[2]);
+}
+
+rgb8_pixel_t decodePixel(Decoder& dec) {
+    uint8_t r = dec.get<uint8_t>();
+    uint8_t g = dec.get<uint8_t>();
+    uint8_t b = dec.get<uint8_t>();
+    return rgb8_pixel_t(r, g, b);
+}
+
+bool writeFully(int fd, const char* buf, size_t size) {
+    while (size > 0) {
+        ssize_t n = send(fd, buf, size, MSG_NOSIGNAL);
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        size -= n;
+    }
+    return true;
+}
+
+bool readFully(int fd, char* buf, size_t size) {
+    while (size > 0) {
+        ssize_t n = read(fd, buf, size);
+        if (n <= 0) {
+            return false;
+        }
+        buf += n;
+        size -= n;
+    }
+    return true;
+}
+
+}
+
+void encodeJob(Encoder& enc, const RenderJob& job) {
+    enc.put(job.numSamples);
+    enc.put(job.seed);
+    enc.put(job.format);
+    enc.put<int32_t>(job.numThreads);
+    enc.put(job.tone.brightness);
+    enc.put(job.tone.gamma);
+    enc.put(job.tone.vibrancy);
+    encodePixel(enc, job.palette.getFrom());
+    encodePixel(enc, job.palette.getTo());
+}
+
+RenderJob decodeJob(Decoder& dec) {
+    RenderJob job;
+    job.numSamples = dec.get<uint64_t>();
+    job.seed = dec.get<uint64_t>();
+    job.format = dec.get<AccumFormat>();
+    job.numThreads = dec.get<int32_t>();
+    job.tone.brightness = dec.get<double>();
+    job.tone.gamma = dec.get<double>();
+    job.tone.vibrancy = dec.get<double>();
+    auto from = decodePixel(dec);
+    auto to = decodePixel(dec);
+    job.palette = Palette(from, to);
+    return job;
+}
+
+void encodeFlame(Encoder& enc, const Flame& flame) {
+    enc.put(flame.logscale);
+    enc.put<int32_t>(flame.width);
+    enc.put<int32_t>(flame.height);
+    enc.put<uint32_t>(flame.transforms.size());
+    for (auto& m: flame.transforms) {
+        encodeComplex(enc, m.a);
+        encodeComplex(enc, m.b);
+        encodeComplex(enc, m.c);
+        encodeComplex(enc, m.d);
+    }
+    enc.put<uint32_t>(flame.colorParams.colorValues.size());
+    for (double v: flame.colorParams.colorValues) {
+        enc.put(v);
+    }
+}
+
+Flame decodeFlame(Decoder& dec) {
+    Flame flame;
+    flame.logscale = dec.get<double>();
+    flame.width = dec.get<int32_t>();
+    flame.height = dec.get<int32_t>();
+    uint32_t numTransforms = dec.get<uint32_t>();
+    for (uint32_t i=0; i<numTransforms; i++) {
+        auto a = decodeComplex(dec);
+        auto b = decodeComplex(dec);
+        auto c = decodeComplex(dec);
+        auto d = decodeComplex(dec);
+        flame.transforms.push_back(Mobius<double>(a, b, c, d));
+    }
+    uint32_t numColors = dec.get<uint32_t>();
+    for (uint32_t i=0; i<numColors; i++) {
+        flame.colorParams.colorValues.push_back(dec.get<double>());
+    }
+    return flame;
+}
+
+void encodeImage(Encoder& enc, const rgb8_image_t& image) {
+    auto view = boost::gil::const_view(image);
+    enc.put<int32_t>(view.width());
+    enc.put<int32_t>(view.height());
+    for (int y=0; y<view.height(); y++) {
+        enc.putBytes(&view.row_begin(y)[0], view.width()*sizeof(rgb8_pixel_t));
+    }
+}
+
+rgb8_image_t decodeImage(Decoder& dec) {
+    int width = dec.get<int32_t>();
+    int height = dec.get<int32_t>();
+    rgb8_image_t image(width, height);
+    auto view = boost::gil::view(image);
+    for (int y=0; y<height; y++) {
+        memcpy((void*)&view.row_begin(y)[0], dec.take(width*sizeof(rgb8_pixel_t)),
+            width*sizeof(rgb8_pixel_t));
+    }
+    return image;
+}
+
+bool sendMessage(int fd, MessageType type, const std::string& payload) {
+    uint32_t header[2] = {(uint32_t)type, (uint32_t)payload.size()};
+    return writeFully(fd, (const char*)header, sizeof(header)) &&
+        writeFully(fd, payload.data(), payload.size());
+}
+
+bool readMessage(int fd, MessageType& type, std::string& payload) {
+    uint32_t header[2];
+    if (!readFully(fd, (char*)header, sizeof(header))) {
+        return false;
+    }
+    type = (MessageType)header[0];
+    payload.resize(header[1]);
+    return readFully(fd, &payload[0], payload.size());
+}
+
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "../gasket/flame.hpp"
+#include "job.hpp"
+#include <boost/gil.hpp>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace render {
+
+enum class MessageType : uint32_t {
+    Job,
+    Range,
+    Frame,
+    Shutdown,
+    // A frame index followed by the error text, sent when a frame of a range
+    // could not be rendered.
+    Failed
+};
+
+class Encoder {
+public:
+    template <typename V>
+    void put(V v) {
+        data.append((const char*)&v, sizeof(V));
+    }
+    void putBytes(const void* bytes, size_t size) {
+        data.append((const char*)bytes, size);
+    }
+    std::string data;
+};
+
+class Decoder {
+public:
+    Decoder(const std::string& data_): data(data_) { }
+    template <typename V>
+    V get() {
+        V v;
+        memcpy(&v, take(sizeof(V)), sizeof(V));
+        return v;
+    }
+    const char* take(size_t size) {
+        if (pos + size > data.size()) {
+            throw std::runtime_error("Truncated message.");
+        }
+        const char* ans = data.data() + pos;
+        pos += size;
+        return ans;
+    }
+private:
+    const std::string& data;
+    size_t pos = 0;
+};
+
+void encodeJob(Encoder& enc, const RenderJob& job);
+RenderJob decodeJob(Decoder& dec);
+void encodeFlame(Encoder& enc, const gasket::Flame& flame);
+gasket::Flame decodeFlame(Decoder& dec);
+void encodeImage(Encoder& enc, const boost::gil::rgb8_image_t& image);
+boost::gil::rgb8_image_t decodeImage(Decoder& dec);
+
+bool sendMessage(int fd, MessageType type, const std::string& payload);
+bool readMessage(int fd, MessageType& type, std::string& payload);
+
+}
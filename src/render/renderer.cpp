@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <stdexcept>
+#include "renderer.hpp"
+
+namespace render {
+
+using gasket::Flame;
+using std::vector;
+
+Renderer::Renderer(AccumFormat format_, int numThreads_, uint64_t flushInterval_):
+    format(format_), numThreads(numThreads_), flushInterval(flushInterval_) {
+
+    if (numThreads < 0) {
+        throw std::invalid_argument("Number of threads must not be negative.");
+    }
+    if (numThreads == 0) {
+        numThreads = gasket::availableCores();
+    }
+    uint64_t limit = UINT64_MAX;
+    switch (format) {
+        case AccumFormat::Double:
+            limit = ScatterBuffer<double, double>::maxSamples();
+            break;
+        case AccumFormat::CountFloat:
+            limit = ScatterBuffer<uint32_t, float>::maxSamples();
+            break;
+        case AccumFormat::Float:
+            limit = ScatterBuffer<float, float>::maxSamples();
+            break;
+    }
+    flushInterval = (flushInterval == 0) ? limit : std::min(flushInterval, limit);
+}
+
+Renderer::Renderer(std::shared_ptr<gasket::WorkerPool> pool_, AccumFormat format_,
+    uint64_t flushInterval_): Renderer(format_, pool_->size(), flushInterval_) {
+
+    pool = pool_;
+}
+
+void Renderer::render(const Flame& flame, Histogram& histogram,
+    uint64_t numSamples, uint64_t seed) const {
+
+    render(vector<Flame>{flame}, histogram, numSamples, seed);
+}
+
+void Renderer::render(const Flame& flame, Histogram& histogram,
+    uint64_t numSamples, vector<Rng>& streams) const {
+
+    render(vector<Flame>{flame}, histogram, numSamples, streams);
+}
+
+void Renderer::render(const vector<Flame>& subframes, Histogram& histogram,
+    uint64_t numSamples, uint64_t seed) const {
+
+    vector<Rng> streams;
+    for (int i=0; i<numThreads; i++) {
+        streams.push_back(Rng::forStream(seed, i));
+    }
+    render(subframes, histogram, numSamples, streams);
+}
+
+void Renderer::render(const vector<Flame>& subframes, Histogram& histogram,
+    uint64_t numSamples, vector<Rng>& streams) const {
+
+    render(subframes, histogram, numSamples, streams, OrbitColor());
+}
+
+void Renderer::validate(const vector<Flame>& subframes, const Histogram& histogram,
+    const vector<Rng>& streams) {
+
+    if (streams.empty()) {
+        throw std::invalid_argument("Renderer needs at least one random stream.");
+    }
+    if (subframes.empty()) {
+        throw std::invalid_argument("Renderer needs at least one flame.");
+    }
+    for (auto& flame: subframes) {
+        if (histogram.width != flame.width || histogram.height != flame.height) {
+            throw std::invalid_argument("Histogram size does not match flame.");
+        }
+        if (flame.transforms.empty() ||
+            flame.transforms.size() != flame.colorParams.colorValues.size()) {
+
+            throw std::invalid_argument("Flame needs one color value per transform.");
+        }
+    }
+}
+
+vector<kernel::Subframe> Renderer::makeTable(const vector<Flame>& subframes,
+    int& numTransforms) {
+
+    vector<kernel::Subframe> table;
+    numTransforms = subframes[0].transforms.size();
+    for (auto& flame: subframes) {
+        kernel::Subframe sub;
+        for (auto& m: flame.transforms) {
+            sub.coefs.push_back(kernel::toCoefs(m));
+        }
+        sub.colors = flame.colorParams.colorValues;
+        table.push_back(sub);
+        if (sub.coefs.size() != numTransforms) {
+            numTransforms = 0;
+        }
+    }
+    return table;
+}
+
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include "../gasket/flame.hpp"
+#include "../gasket/scheduling.hpp"
+#include "histogram.hpp"
+#include "kernel.hpp"
+#include "rng.hpp"
+#include <atomic>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+namespace render {
+
+// Colours a sample with its orbit's running blend of the flame's transform
+// colour values.
+struct OrbitColor {
+    double operator()(double x, double y, double c) const {
+        return c;
+    }
+};
+
+class Renderer {
+public:
+    // Each stream flushes its private buffer into the histogram every
+    // flushInterval samples; zero flushes only as often as the accumulation
+    // format's precision requires, which also caps any explicit interval.
+    // Zero threads sizes the renderer from gasket::availableCores().
+    Renderer(AccumFormat format = AccumFormat::Double, int numThreads = 0,
+        uint64_t flushInterval = 0);
+    // Renders on a pool shared with other stages, one random stream per
+    // worker. Must not be called from a task running on that pool.
+    Renderer(std::shared_ptr<gasket::WorkerPool> pool, AccumFormat format = AccumFormat::Double,
+        uint64_t flushInterval = 0);
+    void render(const gasket::Flame& flame, Histogram& histogram,
+        uint64_t numSamples, uint64_t seed) const;
+    void render(const gasket::Flame& flame, Histogram& histogram,
+        uint64_t numSamples, std::vector<Rng>& streams) const;
+    void render(const std::vector<gasket::Flame>& subframes, Histogram& histogram,
+        uint64_t numSamples, uint64_t seed) const;
+    void render(const std::vector<gasket::Flame>& subframes, Histogram& histogram,
+        uint64_t numSamples, std::vector<Rng>& streams) const;
+    // Accumulates sampleColor(x, y, c) for each sample at (x, y), where c is
+    // the orbit colour OrbitColor returns; the result should lie in [0, 1].
+    // The hook is called directly from the kernel, so it can be inlined.
+    template <typename SampleColor>
+    void render(const std::vector<gasket::Flame>& subframes, Histogram& histogram,
+        uint64_t numSamples, std::vector<Rng>& streams, const SampleColor& sampleColor) const;
+    uint64_t getFlushInterval() const {
+        return flushInterval;
+    }
+    void setCancelFlag(const std::atomic<bool>* cancel_) {
+        cancel = cancel_;
+    }
+private:
+    static void validate(const std::vector<gasket::Flame>& subframes,
+        const Histogram& histogram, const std::vector<Rng>& streams);
+    // Sets numTransforms to the count shared by every subframe, or zero.
+    static std::vector<kernel::Subframe> makeTable(const std::vector<gasket::Flame>& subframes,
+        int& numTransforms);
+    template <typename CountT, typename ColorT, typename SampleColor>
+    void renderWith(const std::vector<gasket::Flame>& subframes, Histogram& histogram,
+        uint64_t numSamples, std::vector<Rng>& streams, const SampleColor& sampleColor) const;
+
+    AccumFormat format;
+    int numThreads;
+    uint64_t flushInterval;
+    std::shared_ptr<gasket::WorkerPool> pool;
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+template <typename SampleColor>
+void Renderer::render(const std::vector<gasket::Flame>& subframes, Histogram& histogram,
+    uint64_t numSamples, std::vector<Rng>& streams, const SampleColor& sampleColor) const {
+
+    validate(subframes, histogram, streams);
+    switch (format) {
+        case AccumFormat::Double:
+            renderWith<double, double>(subframes, histogram, numSamples, streams, sampleColor);
+            break;
+        case AccumFormat::CountFloat:
+            renderWith<uint32_t, float>(subframes, histogram, numSamples, streams, sampleColor);
+            break;
+        case AccumFormat::Float:
+            renderWith<float, float>(subframes, histogram, numSamples, streams, sampleColor);
+            break;
+    }
+}
+
+template <typename CountT, typename ColorT, typename SampleColor>
+void Renderer::renderWith(const std::vector<gasket::Flame>& subframes, Histogram& histogram,
+    uint64_t numSamples, std::vector<Rng>& streams, const SampleColor& sampleColor) const {
+
+    int numTransforms;
+    std::vector<kernel::Subframe> table = makeTable(subframes, numTransforms);
+    int numSubframes = table.size();
+    kernel::Context ctx;
+    ctx.width = histogram.width;
+    ctx.height = histogram.height;
+    ctx.halfHeight = ctx.height / 2.0;
+    ctx.ar = ctx.width / (double)ctx.height;
+    ctx.flushInterval = flushInterval;
+    ctx.cancel = cancel;
+
+    std::mutex lock;
+    std::condition_variable finished;
+    std::optional<boost::asio::thread_pool> ownPool;
+    if (!pool) {
+        ownPool.emplace(numThreads);
+    }
+    boost::asio::thread_pool& threadPool = pool ? pool->get() : *ownPool;
+    int numStreams = streams.size();
+    int pending = numStreams;
+    for (int i=0; i<numStreams; i++) {
+        uint64_t n = numSamples / numStreams + ((uint64_t)i < numSamples % numStreams ? 1 : 0);
+        boost::asio::post(threadPool, [&, i, n] {
+            ScatterBuffer<CountT, ColorT> buffer(ctx.width*ctx.height);
+            Rng rng = streams[i];
+            kernel::Context streamCtx = ctx;
+            // Batches are long enough to amortise the fuse after each switch,
+            // but never so long that a stream misses part of the table.
+            uint64_t batch = std::max(kernel::MIN_SUBFRAME_BATCH,
+                n / (numSubframes*kernel::BATCHES_PER_SUBFRAME));
+            streamCtx.batch = (numSubframes == 1) ? n :
+                std::max<uint64_t>(1, std::min(batch, n / numSubframes));
+            // Batches clamped below the minimum carry the point over instead:
+            // neighbouring subframes have nearby attractors, and re-fusing
+            // would cost more iterations than a short batch counts.
+            streamCtx.refuse = numSubframes > 1 &&
+                streamCtx.batch >= kernel::MIN_SUBFRAME_BATCH;
+            auto flush = [&](uint64_t pending) {
+                std::lock_guard<std::mutex> guard(lock);
+                histogram.addSamples(pending);
+                buffer.flushInto(histogram);
+            };
+            int first = (uint64_t)i*numSubframes / numStreams;
+            switch (numTransforms) {
+                case 3:
+                    kernel::scatter<3>(table, streamCtx, first, n, rng, buffer, sampleColor,
+                        flush);
+                    break;
+                case 6:
+                    kernel::scatter<6>(table, streamCtx, first, n, rng, buffer, sampleColor,
+                        flush);
+                    break;
+                default:
+                    kernel::scatter<0>(table, streamCtx, first, n, rng, buffer, sampleColor,
+                        flush);
+                    break;
+            }
+            std::lock_guard<std::mutex> guard(lock);
+            streams[i] = rng;
+            if (--pending == 0) {
+                finished.notify_all();
+            }
+        });
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&] { return pending == 0; });
+}
+
+}
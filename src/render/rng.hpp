@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+
+namespace render {
+
+class Rng {
+public:
+    Rng(uint64_t state_ = 0): state(state_) { }
+    uint64_t next() {
+        uint64_t z = (state += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+    double uniform() {
+        return (next() >> 11) * 0x1.0p-53;
+    }
+    int pick(int n) {
+        return ((next() >> 32) * n) >> 32;
+    }
+    uint64_t getState() const {
+        return state;
+    }
+    static Rng forStream(uint64_t seed, int stream) {
+        Rng seeder(seed);
+        for (int i=0; i<stream; i++) {
+            seeder.next();
+        }
+        return Rng(seeder.next());
+    }
+private:
+    uint64_t state;
+};
+
+}
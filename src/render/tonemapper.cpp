@@ -0,0 +1,177 @@
+#include <algorithm>
+#include <boost/asio/post.hpp>
+#include <boost/asio/thread_pool.hpp>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include "tonemapper.hpp"
+
+namespace render {
+
+namespace {
+
+// Pixels are tonemapped in fixed-size blocks so the per-channel loops have a
+// constant trip count the compiler can vectorize.
+constexpr int BLOCK = 8;
+constexpr int LUT_SIZE = 1024;
+constexpr int ALPHA_LUT_SIZE = 4096;
+constexpr int ROWS_PER_TASK = 16;
+
+// Palette channels and their gamma-corrected values, in [0, 1], sampled at
+// LUT_SIZE evenly spaced colour coordinates. Since pow(alpha*v, 1/gamma) is
+// pow(alpha, 1/gamma)*pow(v, 1/gamma), the vibrancy blend only needs one pow
+// per pixel once the palette side is tabulated.
+struct PaletteLut {
+    PaletteLut(const Palette& palette, float invGamma) {
+        for (int i=0; i<LUT_SIZE; i++) {
+            double t = i / (double)(LUT_SIZE-1);
+            for (int c=0; c<3; c++) {
+                value[c][i] = palette.channel(t, c) / 255;
+                gammaValue[c][i] = std::pow(value[c][i], invGamma);
+            }
+        }
+    }
+    float value[3][LUT_SIZE];
+    float gammaValue[3][LUT_SIZE];
+};
+
+// Buckets count whole samples, and most of them hold only a few, so the
+// gamma-corrected alpha is tabulated for small counts.
+struct AlphaLut {
+    AlphaLut(float brightness_, float norm_, float invGamma_):
+        brightness(brightness_), norm(norm_), invGamma(invGamma_) {
+
+        for (int i=0; i<ALPHA_LUT_SIZE; i++) {
+            alphaGamma[i] = compute(i);
+        }
+    }
+    float operator()(double count) const {
+        if (count < ALPHA_LUT_SIZE && count == (int)count) {
+            return alphaGamma[(int)count];
+        }
+        return compute(count);
+    }
+    float compute(double count) const {
+        float alpha = std::min(1.0f, brightness*std::log1p((float)count)*norm);
+        return std::pow(alpha, invGamma);
+    }
+    float brightness, norm, invGamma;
+    float alphaGamma[ALPHA_LUT_SIZE];
+};
+
+void tonemapRows(const Bucket* buckets, int width, int y0, int y1, const PaletteLut& lut,
+    const AlphaLut& alphaLut, const ToneParams& params, const boost::gil::rgb8_view_t& view) {
+
+    float vibrancy = params.vibrancy;
+    for (int y=y0; y<y1; y++) {
+        const Bucket* row = buckets + (size_t)y*width;
+        uint8_t* out = &view.row_begin(y)[0][0];
+        for (int x0=0; x0<width; x0+=BLOCK) {
+            int n = std::min(BLOCK, width-x0);
+            // Most of a frame is usually empty, so blank blocks are written
+            // directly instead of going through the lookups.
+            bool empty = true;
+            for (int i=0; i<n; i++) {
+                empty &= row[x0+i].count == 0;
+            }
+            if (empty) {
+                std::fill_n(out + 3*x0, 3*n, 0);
+                continue;
+            }
+            float alphaGamma[BLOCK] = { };
+            int index[BLOCK] = { };
+            for (int i=0; i<n; i++) {
+                const Bucket& b = row[x0+i];
+                if (b.count > 0) {
+                    alphaGamma[i] = alphaLut(b.count);
+                    float t = std::clamp((float)(b.color / b.count), 0.0f, 1.0f);
+                    index[i] = (int)(t*(LUT_SIZE-1) + 0.5f);
+                }
+            }
+            uint8_t pixels[3][BLOCK];
+            for (int c=0; c<3; c++) {
+                float v[BLOCK], vg[BLOCK];
+                for (int i=0; i<BLOCK; i++) {
+                    v[i] = lut.value[c][index[i]];
+                    vg[i] = lut.gammaValue[c][index[i]];
+                }
+                for (int i=0; i<BLOCK; i++) {
+                    float val = alphaGamma[i]*(vibrancy*v[i] + (1-vibrancy)*vg[i]);
+                    pixels[c][i] = (uint8_t)std::clamp(val*255 + 0.5f, 0.0f, 255.0f);
+                }
+            }
+            for (int i=0; i<n; i++) {
+                for (int c=0; c<3; c++) {
+                    out[3*(x0+i) + c] = pixels[c][i];
+                }
+            }
+        }
+    }
+}
+
+// Tonemaps on threadPool, or on the calling thread when it is null. Tasks are
+// counted rather than joined, so the pool may be shared with other work.
+void tonemapOn(const Histogram& histogram, const Palette& palette, const ToneParams& params,
+    const boost::gil::rgb8_view_t& view, boost::asio::thread_pool* threadPool) {
+
+    if (view.width() != histogram.width || view.height() != histogram.height) {
+        throw std::invalid_argument("View size does not match histogram.");
+    }
+    double meanCount = histogram.getSamples() / (double)histogram.size();
+    float norm = 1/std::log1p(4*meanCount);
+    float invGamma = 1/params.gamma;
+    PaletteLut lut(palette, invGamma);
+    AlphaLut alphaLut(params.brightness, norm, invGamma);
+    const Bucket* buckets = histogram.data();
+    int width = histogram.width;
+    int height = histogram.height;
+
+    if (!threadPool || height <= ROWS_PER_TASK) {
+        tonemapRows(buckets, width, 0, height, lut, alphaLut, params, view);
+        return;
+    }
+    std::mutex lock;
+    std::condition_variable finished;
+    int pending = (height + ROWS_PER_TASK - 1) / ROWS_PER_TASK;
+    for (int y=0; y<height; y+=ROWS_PER_TASK) {
+        int y1 = std::min(height, y+ROWS_PER_TASK);
+        boost::asio::post(*threadPool, [&, y, y1] {
+            tonemapRows(buckets, width, y, y1, lut, alphaLut, params, view);
+            std::lock_guard<std::mutex> guard(lock);
+            if (--pending == 0) {
+                finished.notify_all();
+            }
+        });
+    }
+    std::unique_lock<std::mutex> guard(lock);
+    finished.wait(guard, [&] { return pending == 0; });
+}
+
+}
+
+void tonemap(const Histogram& histogram, const Palette& palette, const ToneParams& params,
+    const boost::gil::rgb8_view_t& view, int numThreads) {
+
+    if (numThreads < 0) {
+        throw std::invalid_argument("Number of threads must not be negative.");
+    }
+    if (numThreads == 0) {
+        numThreads = gasket::availableCores();
+    }
+    if (numThreads == 1 || histogram.height <= ROWS_PER_TASK) {
+        tonemapOn(histogram, palette, params, view, nullptr);
+        return;
+    }
+    boost::asio::thread_pool threadPool(numThreads);
+    tonemapOn(histogram, palette, params, view, &threadPool);
+    threadPool.join();
+}
+
+void tonemap(const Histogram& histogram, const Palette& palette, const ToneParams& params,
+    const boost::gil::rgb8_view_t& view, gasket::WorkerPool& pool) {
+
+    tonemapOn(histogram, palette, params, view, pool.size() == 1 ? nullptr : &pool.get());
+}
+
+}
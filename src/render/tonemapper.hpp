@@ -0,0 +1,25 @@
+#pragma once
+
+#include "../gasket/scheduling.hpp"
+#include "histogram.hpp"
+#include "palette.hpp"
+#include <boost/gil.hpp>
+
+namespace render {
+
+struct ToneParams {
+    double brightness = 1;
+    double gamma = 2.2;
+    double vibrancy = 1;
+};
+
+// Rows are split across numThreads workers, or gasket::availableCores() when
+// it is zero; the palette is sampled into a lookup table once per call.
+void tonemap(const Histogram& histogram, const Palette& palette, const ToneParams& params,
+    const boost::gil::rgb8_view_t& view, int numThreads = 1);
+// Runs on a pool shared with other stages. Must not be called from a task
+// running on that pool.
+void tonemap(const Histogram& histogram, const Palette& palette, const ToneParams& params,
+    const boost::gil::rgb8_view_t& view, gasket::WorkerPool& pool);
+
+}
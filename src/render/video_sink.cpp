@@ -0,0 +1,197 @@
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "video_sink.hpp"
+
+namespace render {
+
+using std::string;
+using std::vector;
+
+namespace {
+
+sigset_t pipeSignal() {
+    sigset_t set;
+    sigemptyset(&set);
+    sigaddset(&set, SIGPIPE);
+    return set;
+}
+
+}
+
+VideoSink::VideoSink(const string& path, int width_, int height_, VideoFormat format_,
+    int fpsNum, int fpsDen, bool createPipe): width(width_), height(height_),
+    format(format_), available{0, 1} {
+
+    if (width <= 0 || height <= 0 || fpsNum <= 0 || fpsDen <= 0) {
+        throw std::invalid_argument("Invalid video parameters.");
+    }
+    if (path == "-") {
+        fd = STDOUT_FILENO;
+        ownsFd = false;
+    } else {
+        if (createPipe && mkfifo(path.c_str(), 0644) < 0 && errno != EEXIST) {
+            throw std::runtime_error("Could not create pipe " + path + ".");
+        }
+        fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            throw std::runtime_error("Could not open " + path + ".");
+        }
+        ownsFd = true;
+    }
+    for (auto& slot: slots) {
+        slot.resize((size_t)width*height*3);
+    }
+    if (format == VideoFormat::Y4m) {
+        header = "YUV4MPEG2 W" + std::to_string(width) + " H" + std::to_string(height) +
+            " F" + std::to_string(fpsNum) + ":" + std::to_string(fpsDen) + " Ip A1:1 C444\n";
+        planes.resize((size_t)width*height*3);
+    }
+    thread = std::thread([this] { loop(); });
+}
+
+VideoSink::~VideoSink() {
+    try {
+        close();
+    } catch (const std::runtime_error&) {
+
+    }
+}
+
+void VideoSink::write(const boost::gil::rgb8c_view_t& frame) {
+    if (frame.width() != width || frame.height() != height) {
+        throw std::invalid_argument("Frame size does not match video.");
+    }
+    int slot;
+    {
+        std::unique_lock<std::mutex> guard(lock);
+        changed.wait(guard, [this] { return !available.empty() || !error.empty(); });
+        if (!error.empty()) {
+            throw std::runtime_error(error);
+        }
+        if (closing) {
+            throw std::runtime_error("Video sink is closed.");
+        }
+        slot = available.back();
+        available.pop_back();
+    }
+    uint8_t* dst = slots[slot].data();
+    for (int y=0; y<height; y++) {
+        memcpy(dst + (size_t)y*width*3, &frame.row_begin(y)[0], (size_t)width*3);
+    }
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        filled.push_back(slot);
+    }
+    changed.notify_all();
+}
+
+void VideoSink::close() {
+    {
+        std::lock_guard<std::mutex> guard(lock);
+        if (closing) {
+            return;
+        }
+        closing = true;
+    }
+    changed.notify_all();
+    thread.join();
+    if (ownsFd) {
+        ::close(fd);
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+}
+
+// All output, header included, is written from this thread. A reader that
+// goes away, such as an encoder that exits, must surface as EPIPE through
+// write() rather than kill the process, so SIGPIPE stays blocked here and a
+// pending one is consumed after a failed write.
+void VideoSink::loop() {
+    sigset_t signals = pipeSignal();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+    std::unique_lock<std::mutex> guard(lock);
+    if (!header.empty()) {
+        guard.unlock();
+        try {
+            writeAll((const uint8_t*)header.data(), header.size());
+        } catch (const std::runtime_error& e) {
+            guard.lock();
+            error = e.what();
+            changed.notify_all();
+            return;
+        }
+        guard.lock();
+    }
+    while (true) {
+        changed.wait(guard, [this] { return closing || !filled.empty(); });
+        if (filled.empty()) {
+            return;
+        }
+        int slot = filled.front();
+        filled.pop_front();
+        guard.unlock();
+        try {
+            if (format == VideoFormat::Y4m) {
+                convertY4m(slots[slot]);
+                writeAll((const uint8_t*)"FRAME\n", 6);
+                writeAll(planes.data(), planes.size());
+            } else {
+                writeAll(slots[slot].data(), slots[slot].size());
+            }
+        } catch (const std::runtime_error& e) {
+            guard.lock();
+            error = e.what();
+            filled.clear();
+            changed.notify_all();
+            return;
+        }
+        guard.lock();
+        available.push_back(slot);
+        changed.notify_all();
+    }
+}
+
+void VideoSink::writeAll(const uint8_t* data, size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            int err = errno;
+            if (err == EPIPE) {
+                sigset_t signals = pipeSignal();
+                struct timespec zero = {0, 0};
+                sigtimedwait(&signals, nullptr, &zero);
+            }
+            throw std::runtime_error(string("Video write failed: ") + strerror(err) + ".");
+        }
+        data += n;
+        size -= n;
+    }
+}
+
+void VideoSink::convertY4m(const vector<uint8_t>& rgb) {
+    size_t n = (size_t)width*height;
+    uint8_t* py = planes.data();
+    uint8_t* pu = py + n;
+    uint8_t* pv = pu + n;
+    for (size_t i=0; i<n; i++) {
+        int r = rgb[3*i];
+        int g = rgb[3*i+1];
+        int b = rgb[3*i+2];
+        py[i] = ((66*r + 129*g + 25*b + 128) >> 8) + 16;
+        pu[i] = ((-38*r - 74*g + 112*b + 128) >> 8) + 128;
+        pv[i] = ((112*r - 94*g - 18*b + 128) >> 8) + 128;
+    }
+}
+
+}
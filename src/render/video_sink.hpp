@@ -0,0 +1,51 @@
+#pragma once
+
+#include <array>
+#include <boost/gil.hpp>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace render {
+
+enum class VideoFormat {
+    Y4m,
+    RawRgb
+};
+
+class VideoSink {
+public:
+    VideoSink(const std::string& path, int width, int height,
+        VideoFormat format = VideoFormat::Y4m, int fpsNum = 30, int fpsDen = 1,
+        bool createPipe = false);
+    VideoSink(const VideoSink&) = delete;
+    VideoSink& operator=(const VideoSink&) = delete;
+    ~VideoSink();
+    void write(const boost::gil::rgb8c_view_t& frame);
+    void close();
+private:
+    void loop();
+    void writeAll(const uint8_t* data, size_t size);
+    void convertY4m(const std::vector<uint8_t>& rgb);
+
+    int fd;
+    bool ownsFd;
+    int width, height;
+    VideoFormat format;
+    std::array<std::vector<uint8_t>, 2> slots;
+    std::vector<uint8_t> planes;
+    std::string header;
+    std::deque<int> filled;
+    std::vector<int> available;
+    bool closing = false;
+    std::string error;
+    std::mutex lock;
+    std::condition_variable changed;
+    std::thread thread;
+};
+
+}
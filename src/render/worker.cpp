@@ -0,0 +1,80 @@
+#include <cstring>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "protocol.hpp"
+#include "worker.hpp"
+
+namespace render {
+
+using std::string;
+
+Worker::Worker(const string& socketPath_, int defaultThreads_): socketPath(socketPath_),
+    defaultThreads(defaultThreads_) {
+
+    if (socketPath.size() >= sizeof(sockaddr_un::sun_path)) {
+        throw std::invalid_argument("Socket path too long.");
+    }
+    if (defaultThreads < 0) {
+        throw std::invalid_argument("Number of threads must not be negative.");
+    }
+}
+
+int Worker::run() {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return 1;
+    }
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    socketPath.copy(addr.sun_path, socketPath.size());
+    if (connect(fd, (sockaddr*)&addr, sizeof(addr)) < 0) {
+        close(fd);
+        return 1;
+    }
+    RenderJob job;
+    MessageType type;
+    string payload;
+    try {
+        while (readMessage(fd, type, payload)) {
+            Decoder dec(payload);
+            if (type == MessageType::Job) {
+                job = decodeJob(dec);
+                if (job.numThreads == 0) {
+                    job.numThreads = defaultThreads;
+                }
+            } else if (type == MessageType::Range) {
+                uint32_t count = dec.get<uint32_t>();
+                for (uint32_t i=0; i<count; i++) {
+                    uint32_t index = dec.get<uint32_t>();
+                    auto flame = decodeFlame(dec);
+                    Encoder enc;
+                    enc.put(index);
+                    MessageType reply = MessageType::Frame;
+                    try {
+                        encodeImage(enc, renderFrame(job, flame, job.seed + index));
+                    } catch (const std::exception& e) {
+                        // Reported so that only this frame is charged an attempt.
+                        reply = MessageType::Failed;
+                        enc.putBytes(e.what(), strlen(e.what()));
+                    }
+                    if (!sendMessage(fd, reply, enc.data)) {
+                        close(fd);
+                        return 1;
+                    }
+                }
+            } else if (type == MessageType::Shutdown) {
+                close(fd);
+                return 0;
+            }
+        }
+    } catch (const std::exception&) {
+        // A malformed message leaves the stream unusable; the coordinator
+        // requeues whatever was assigned here.
+    }
+    close(fd);
+    return 1;
+}
+
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+
+namespace render {
+
+class Worker {
+public:
+    // Jobs that leave their thread count at zero run defaultThreads threads,
+    // or one per available core when that is zero too.
+    Worker(const std::string& socketPath, int defaultThreads = 0);
+    int run();
+private:
+    std::string socketPath;
+    int defaultThreads;
+};
+
+}